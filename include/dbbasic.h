@@ -27,6 +27,84 @@
 #include "flags.h"
 
 
+/**
+ * @struct catalog_listener
+ * @brief told of names appearing under or vanishing from a tag, with the
+ * file id of a file, KW_FAIL for a tag, as a removed file is gone by then
+ * @note called after the change is made, on the thread making it, and
+ * for changes held by hold_catalog_changes once they are committed
+ */
+struct catalog_listener {
+	void (*entry_changed)(int tno, int fno, const char *name);
+};
+
+/*
+ * Set listener told of catalog changes, NULL for none
+ */
+void set_catalog_listener(const struct catalog_listener *listener);
+
+/*
+ * Get number changed each time the catalog changes
+ */
+unsigned int get_catalog_generation(void);
+
+/*
+ * Hold notifications and counts of changes made by this thread
+ */
+void hold_catalog_changes(void);
+
+/*
+ * Send held changes if applied, drop them if rolled back
+ */
+void release_catalog_changes(bool applied);
+
+/**
+ * @struct catalog_counts
+ * @brief size of catalog, kept in memory as files and tags are added and
+ * removed
+ */
+struct catalog_counts {
+	long long files; /* files in kwest */
+	long long tags; /* tags in kwest */
+	long long bytes; /* size of files on disk when they were counted */
+};
+
+/*
+ * Count files, tags and bytes of files in kwest, once on start
+ */
+int load_catalog_counts(void);
+
+/*
+ * Get counts of catalog without querying database
+ */
+void get_catalog_counts(struct catalog_counts *counts);
+
+/*
+ * Count new size of file, once it was written or truncated
+ */
+void count_file_size(int fno, long long size);
+
+/*
+ * Build filter of names of tags and files in kwest, once before mounting
+ */
+int load_catalog_names(void);
+
+/*
+ * Check if name may be that of a tag or file, false if it surely is not
+ */
+bool catalog_may_have(const char *name);
+
+/*
+ * Get generation of tag id, changed each time it is given to a new tag
+ */
+unsigned int get_tag_generation(int tno);
+
+/*
+ * Get generation of file id, changed each time it is given to a new file
+ */
+unsigned int get_file_generation(int fno);
+
+
 /* ---------------- ADD/REMOVE -------------------- */
 
 /*
@@ -44,6 +122,16 @@ int remove_tag(const char *tagname);
  */
 int add_file(const char *abspath);
 
+/*
+ * Add file to kwest without extracting its metadata
+ */
+int add_new_file(const char *abspath);
+
+/*
+ * Extract metadata of file in kwest from its contents
+ */
+int add_file_metadata(int fno);
+
 /*
  * Remove file form kwest
  */
@@ -86,6 +174,16 @@ sqlite3_stmt *get_tid_under_tag(const char *t);
  */
 sqlite3_stmt *get_tags_for_file(const char *f);
 
+/*
+ * Return comma separated names of tags associated with file given by id
+ */
+char *get_file_tags(int fno);
+
+/*
+ * Replace tags associated with file by comma separated tag names
+ */
+int set_file_tags(int fno, const char *tags);
+
 
 /*----------------- Tag-Tag Relation ------------------*/
 
@@ -152,6 +250,53 @@ bool is_file_tagged_as(const char *f, const char *t);
  */
 char *get_abspath_by_fname(const char *fname);
 
+/*
+ * Return absolute path of file by its id
+ */
+char *get_abspath_by_fno(int fno);
+
+/*
+ * Check if file is associated with tag, both given by id
+ */
+bool is_file_tagged_id(int fno, int tno);
+
+/*
+ * Return type of association between two tags given by id
+ */
+int get_association_id(int t1, int t2);
+
+/*
+ * Return id and name of tags grouped under given tag, from given id on
+ */
+sqlite3_stmt *get_subtags_by_tno(int tno, int from);
+
+/*
+ * Return id, name and absolute path of files associated to given tag,
+ * from given id on
+ */
+sqlite3_stmt *get_files_by_tno(int tno, int from);
+
+/*
+ * Return id, name and absolute path of files associated to given tag,
+ * with ids from from to to
+ */
+sqlite3_stmt *get_files_by_tno_range(int tno, int from, int to);
+
+/*
+ * Return smallest id of file associated to given tag, from given id on
+ */
+int get_next_fno_by_tno(int tno, int from);
+
+/*
+ * Check if more than count files are associated to given tag
+ */
+bool tag_has_more_files(int tno, int count);
+
+/*
+ * Returns id and name for multiple rows in query
+ */
+const char *row_from_stmt(sqlite3_stmt *stmt, int *id);
+
 /*
  * Rename file existing in kwest
  */
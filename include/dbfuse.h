@@ -24,6 +24,7 @@
 #define KWEST_DBFUSE_H
 
 #include <sys/stat.h>
+#include <sys/statvfs.h>
 #include "flags.h"
 
 #define DBFUSE_CP 111
@@ -66,15 +67,30 @@ char *readdir_dirs(const char *path, void **ptr);
 char *readdir_files(const char *path, void **ptr);
 
 /*
- * create a new file and return is absolute path
+ * get absolute path a new file of path is to be created at
  */
 const char *get_newfile_path(const char *path);
 
+/*
+ * create a new file on disk and add it to kwest under parent tag
+ */
+int create_this_file(const char *path, mode_t mode, int flags);
+
 /*
  * rename the said file from -> to
  */
 int rename_this_file(const char *from, const char *to, int mode);
 
+/*
+ * move or copy file from one tag to another
+ */
+int retag_file(const char *tag1, const char *tag2, const char *file, int mode);
+
+/*
+ * tag file of the same name under parent tag of path
+ */
+int copy_this_file(const char *path);
+
 /*
  * remove the said file
  */
@@ -90,4 +106,19 @@ int make_directory(const char *path, mode_t mode);
  */
 int remove_directory(const char *path);
 
+/*
+ * get tags of file as value of its tags extended attribute
+ */
+int get_tags_xattr(int fno, char *value, size_t size);
+
+/*
+ * replace tags of file by value of its tags extended attribute
+ */
+int set_tags_xattr(int fno, const char *value, size_t size);
+
+/*
+ * get statistics of filesystem from counts of catalog
+ */
+void get_statfs(struct statvfs *st);
+
  #endif
@@ -57,4 +57,9 @@ int begin_transaction(void);
  */
 int commit_transaction(void);
 
+/*
+ * Rollback transaction
+ */
+int rollback_transaction(void);
+
 #endif
@@ -0,0 +1,85 @@
+/**
+ * @file dbquery.h
+ * @brief boolean queries over tags given as paths
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KWEST_DBQUERY_H
+#define KWEST_DBQUERY_H
+
+#include <sqlite3.h>
+#include "flags.h"
+
+/* OPERATORS STARTING A QUERY COMPONENT OF PATH */
+#define KW_QUERY_AND '+' /* files under any of the tags */
+#define KW_QUERY_NOT '-' /* files under none of the tags */
+#define KW_QUERY_SEP ',' /* separates tags of a component */
+
+/**
+ * @struct kw_clause
+ * @brief one component of a query path, a union of tags
+ */
+struct kw_clause {
+	char op;             /* KW_QUERY_AND or KW_QUERY_NOT */
+	int ntags;           /* number of tags in union */
+	int *tnos;           /* ids of tags in union */
+	long long files;     /* files under tags, found when planned */
+};
+
+/**
+ * @struct kw_query
+ * @brief clauses of a query path, all of which a file must satisfy
+ */
+struct kw_query {
+	int nclauses;
+	struct kw_clause *clauses;
+	bool planned;        /* clauses are in order of evaluation */
+};
+
+/*
+ * Check if name of path component is a query
+ */
+bool is_query_component(const char *name);
+
+/*
+ * Check if path is a query, starting with a query component
+ */
+bool is_query_path(const char *path);
+
+/*
+ * Parse query path into its clauses
+ */
+struct kw_query *query_parse(const char *path);
+
+/*
+ * Free parsed query
+ */
+void query_free(struct kw_query *q);
+
+/*
+ * Return id, name and absolute path of files satisfying query
+ */
+sqlite3_stmt *query_files(struct kw_query *q, int from);
+
+/*
+ * Check if file satisfies query
+ */
+bool query_matches(struct kw_query *q, int fno);
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * @file dbusage.h
+ * @brief recently and frequently used files
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KWEST_DBUSAGE_H
+#define KWEST_DBUSAGE_H
+
+#include <sqlite3.h>
+#include "flags.h"
+
+/* VIRTUAL TAGS OF USED FILES, directories of root */
+#define USAGE_RECENT   0 /* files by time of last use */
+#define USAGE_FREQUENT 1 /* files by number of opens */
+#define USAGE_KINDS    2
+
+#define USAGE_LIST  64 /* files listed under each virtual tag */
+#define USAGE_FLUSH 30 /* seconds between writes of uses to database */
+
+/*
+ * record open of file by this thread
+ */
+void usage_open(int fno);
+
+/*
+ * record read of file by this thread
+ */
+void usage_read(int fno);
+
+/*
+ * start writing recorded uses to database in the background
+ */
+int usage_start(void);
+
+/*
+ * stop writing uses in the background, after writing those recorded
+ */
+void usage_stop(void);
+
+/*
+ * write uses recorded till now to database
+ */
+void usage_flush(void);
+
+/*
+ * virtual tag holding path, KW_FAIL if path is not under one
+ */
+int usage_of_path(const char *path);
+
+/*
+ * name of virtual tag
+ */
+const char *usage_name(int kind);
+
+/*
+ * Return id, name and absolute path of files under virtual tag
+ */
+sqlite3_stmt *usage_files(int kind, int from);
+
+/*
+ * Check if file is under virtual tag
+ */
+bool usage_has_file(int kind, int fno);
+
+#endif
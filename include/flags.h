@@ -39,10 +39,29 @@
 /* FLAGS RELATED TO FUSE, DIRECTORY VALUES */
 #define KW_STDIR 0755 /* DIR entry in struct stat */
 #define KW_STFIL 0444 /* FILE entry in struct stat */
+#define KW_STLNK 0777 /* FILE entry shown as symlink in struct stat */
+#define KW_STCTL 0200 /* control file in struct stat */
+#define KW_STSTATS 0444 /* stats file in struct stat */
+#define KW_STCTLDIR 0111 /* directory of control file in struct stat */
+#define KW_NOFH  (~0ULL) /* no backing file held in fuse file handle */
+#define KW_STATFS_BSIZE 4096 /* block size reported by statfs */
+#define KW_STATFS_FFREE 65536 /* free inodes if the disk gives none */
+
+/* READDIR OFFSETS, part of listing in high bits and next id in low bits */
+#define KW_DIROFF_DOTS    0 /* . and .. */
+#define KW_DIROFF_TAGS    1 /* tags under listed tag */
+#define KW_DIROFF_FILES   2 /* files under listed tag */
+#define KW_DIROFF_SUGGEST 3 /* suggestions */
+#define KW_DIROFF_SHARDS  4 /* buckets of files under sharded tag */
+#define KW_DIROFF_USAGE   5 /* virtual tags of used files, under root */
+#define KW_DIROFF(part, id)  (((long long)(part) << 40) | (long long)(id))
+#define KW_DIROFF_PART(off)  ((int)((off) >> 40))
+#define KW_DIROFF_ID(off)    ((int)((off) & 0xffffffffffLL))
 
 
 /* FLAGS RELATED TO DATABASE OPERATIONS */
 #define QUERY_SIZE 512 /* Size of array holding query */
+#define KW_DB_BUSY_TIMEOUT 5000 /* ms a connection waits on a locked db */
 
 #define USER_TAG   1 /* Tag Accessible to user */
 #define SYSTEM_TAG 2 /* Tag created and used by system */
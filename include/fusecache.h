@@ -0,0 +1,91 @@
+/**
+ * @file fusecache.h
+ * @brief in-memory caches used by the fuse layer
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KWEST_FUSECACHE_H
+#define KWEST_FUSECACHE_H
+
+#include <sys/stat.h>
+#include "flags.h"
+
+/* KIND OF ENTRY A VIRTUAL PATH RESOLVES TO */
+#define KW_PATH_NONE 0 /* path not in cache */
+#define KW_PATH_TAG  1 /* path resolves to a tag (directory) */
+#define KW_PATH_FILE 2 /* path resolves to a file */
+
+/*
+ * lookup resolved virtual path in cache
+ */
+int pathcache_lookup(const char *path, int *id, char **abspath);
+
+/*
+ * add resolved virtual path to cache
+ */
+void pathcache_insert(const char *path, int kind, int id, const char *abspath);
+
+/*
+ * drop every cached path having name as one of its components
+ */
+void pathcache_invalidate_name(const char *name);
+
+/*
+ * drop every cached path ending in /tagname/filename
+ */
+void pathcache_invalidate_entry(const char *tagname, const char *filename);
+
+/*
+ * drop all cached paths
+ */
+void pathcache_flush(void);
+
+/*
+ * lookup attributes of backing file in cache
+ */
+int statcache_lookup(int fno, struct stat *stbuf);
+
+/*
+ * add attributes of backing file to cache
+ */
+void statcache_insert(int fno, const struct stat *stbuf);
+
+/*
+ * drop cached attributes of file
+ */
+void statcache_invalidate(int fno);
+
+/* KINDS OF SUGGESTIONS FOR A TAG */
+#define KW_SUGGEST_FILPR 0 /* probably related files */
+#define KW_SUGGEST_FILRE 1 /* related files */
+#define KW_SUGGEST_TAGPR 2 /* probably related tags */
+#define KW_SUGGEST_TAGRE 3 /* related tags */
+#define KW_SUGGEST_KINDS 4
+
+/*
+ * lookup suggestions for tag computed at given catalog generation
+ */
+int suggestcache_lookup(int tno, unsigned int generation, char **lists);
+
+/*
+ * add suggestions for tag computed at given catalog generation to cache
+ */
+void suggestcache_insert(int tno, unsigned int generation, char **lists);
+
+#endif
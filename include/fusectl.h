@@ -0,0 +1,58 @@
+/**
+ * @file fusectl.h
+ * @brief control file taking batches of catalog commands
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KWEST_FUSECTL_H
+#define KWEST_FUSECTL_H
+
+#include <stddef.h>
+
+/* CONTROL FILES, IN DIRECTORY UNDER ROOT OF FILE SYSTEM */
+#define CONTROL_DIR  ".kwest"
+#define CONTROL_FILE "control" /* takes catalog commands */
+#define STATS_FILE   "stats"   /* reports counters, see stats.h */
+
+/*
+ * commands written to an open control file, run on flush
+ */
+struct kwest_control;
+
+/*
+ * open control file
+ */
+struct kwest_control *control_open(void);
+
+/*
+ * add data written to control file to its commands
+ */
+int control_write(struct kwest_control *ctl, const char *buf, size_t size);
+
+/*
+ * run commands written to control file in a single transaction
+ */
+int control_flush(struct kwest_control *ctl);
+
+/*
+ * close control file, dropping commands not flushed
+ */
+void control_release(struct kwest_control *ctl);
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * @file fuseopts.h
+ * @brief mount options understood by kwest
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KWEST_FUSEOPTS_H
+#define KWEST_FUSEOPTS_H
+
+#include <stddef.h>
+
+/**
+ * @struct kwest_timeouts
+ * @brief seconds the kernel may cache lookups and attributes of an entry
+ */
+struct kwest_timeouts {
+	double entry;    /* validity of name lookups */
+	double attr;     /* validity of attributes */
+	double negative; /* validity of failed lookups */
+};
+
+/**
+ * @struct kwest_options
+ * @brief options given to kwest with -o on mount
+ */
+struct kwest_options {
+	struct kwest_timeouts tag;     /* tags (directories) */
+	struct kwest_timeouts file;    /* tagged files */
+	struct kwest_timeouts suggest; /* SUGGESTED entries */
+	double stat_timeout; /* validity of daemon side stat cache */
+	int passthrough;     /* let the kernel read and write backing files */
+	int writeback;       /* let the kernel cache writes to files */
+	int io_uring;        /* carry requests over io_uring */
+	int async_reads;     /* reads in flight over io_uring, 0 for none */
+	int symlinks;        /* show files as symlinks to backing files */
+	int shard;           /* files above which a tag is listed in buckets */
+	char *store;         /* directory new files are created in */
+};
+
+#define KWEST_OPT(templ, field) \
+	{ templ, offsetof(struct kwest_options, field), 1 }
+#define KWEST_FLAG(templ, field, value) \
+	{ templ, offsetof(struct kwest_options, field), value }
+
+/**
+ * @brief fuse_opt entries for struct kwest_options
+ * @note expanded inside a struct fuse_opt array by the fuse frontends
+ */
+#define KWEST_FUSE_OPTS \
+	KWEST_OPT("tag_entry_timeout=%lf",       tag.entry), \
+	KWEST_OPT("tag_attr_timeout=%lf",        tag.attr), \
+	KWEST_OPT("tag_negative_timeout=%lf",    tag.negative), \
+	KWEST_OPT("file_entry_timeout=%lf",      file.entry), \
+	KWEST_OPT("file_attr_timeout=%lf",       file.attr), \
+	KWEST_OPT("file_negative_timeout=%lf",   file.negative), \
+	KWEST_OPT("suggest_entry_timeout=%lf",   suggest.entry), \
+	KWEST_OPT("suggest_attr_timeout=%lf",    suggest.attr), \
+	KWEST_OPT("suggest_negative_timeout=%lf", suggest.negative), \
+	KWEST_OPT("stat_timeout=%lf",            stat_timeout), \
+	KWEST_FLAG("passthrough",                passthrough, 1), \
+	KWEST_FLAG("nopassthrough",              passthrough, 0), \
+	KWEST_FLAG("writeback",                  writeback, 1), \
+	KWEST_FLAG("io_uring",                   io_uring, 1), \
+	KWEST_FLAG("noio_uring",                 io_uring, 0), \
+	KWEST_OPT("async_reads=%d",              async_reads), \
+	KWEST_FLAG("symlinks",                   symlinks, 1), \
+	KWEST_OPT("shard=%d",                    shard), \
+	KWEST_OPT("store=%s",                    store)
+
+/*
+ * get options kwest was mounted with
+ */
+struct kwest_options *get_kwest_options(void);
+
+/*
+ * smallest timeouts over all entry classes
+ */
+void kwest_min_timeouts(struct kwest_timeouts *t);
+
+#endif
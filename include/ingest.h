@@ -0,0 +1,59 @@
+/**
+ * @file ingest.h
+ * @brief metadata of written files extracted in the background
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KWEST_INGEST_H
+#define KWEST_INGEST_H
+
+#include "flags.h"
+
+/*
+ * start extracting metadata of queued files in the background
+ */
+int ingest_start(void);
+
+/*
+ * stop extracting metadata in the background, after files queued
+ */
+void ingest_stop(void);
+
+/*
+ * queue file for extraction of its metadata
+ */
+void ingest_queue(int fno);
+
+/*
+ * note handle of file opened for writing
+ */
+void ingest_open(int fno, int fd);
+
+/*
+ * note that file was written, queueing it at once if not open for writing
+ */
+void ingest_written(int fno);
+
+/*
+ * note handle of file opened for writing being closed, queueing the file
+ * once its last handle is closed if it was written
+ */
+void ingest_close(int fno, int fd);
+
+#endif
@@ -30,6 +30,7 @@
 #define DATABASE_NAME "kwest.db"
 
 #define LOGFILE_STORAGE "logfile.log"
+#define STORE_DIR "files" /* new files, unless given by store option */
 
 /* STRINGS RELATED TO DATABASE OPERATIONS */
 #define ERR_DB_CONN "Database Connection Failed"
@@ -37,6 +38,7 @@
 #define ERR_DB_CLOSE "Error Closing Database"
 
 #define ERR_TAG_EXISTS "Tag Exists : "
+#define ERR_TAG_RESERVED "Tag Name Reserved : "
 #define ERR_TAG_NOT_FOUND "Tag Not Found : "
 #define ERR_ADDING_TAG "Error adding tag : "
 #define ERR_REMV_TAG "Error removing tag : "
@@ -50,6 +52,16 @@
 #define ERR_REL_NOT_DEF "Relation Not Defined : "
 #define ERR_PREP_QUERY "Error Preparing query"
 
+/* EXTENDED ATTRIBUTES */
+#define XATTR_TAGS "user.kwest.tags"
+
+/* HIDDEN DIRECTORY UNDER A TAG LISTING ITS SUGGESTIONS */
+#define SUGGEST_DIR ".suggested"
+
+/* VIRTUAL TAGS OF ROOT LISTING RECENTLY AND FREQUENTLY USED FILES */
+#define RECENT_DIR "Recent"
+#define FREQUENT_DIR "Frequent"
+
 /* Association Types */
 #define ASSOC_SYSTEM "system"
 #define ASSOC_PROBAB "probably_related"
@@ -0,0 +1,127 @@
+/**
+ * @file stats.h
+ * @brief counters and latency histograms of kwest operations
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KWEST_STATS_H
+#define KWEST_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* OPERATIONS TIMED, of both fuse frontends */
+enum stats_op {
+	STATS_OTHER = 0, /* statements run outside of an operation */
+	STATS_LOOKUP,
+	STATS_FORGET,
+	STATS_GETATTR,
+	STATS_SETATTR,
+	STATS_READLINK,
+	STATS_MKNOD,
+	STATS_MKDIR,
+	STATS_UNLINK,
+	STATS_RMDIR,
+	STATS_RENAME,
+	STATS_LINK,
+	STATS_CHMOD,
+	STATS_CHOWN,
+	STATS_TRUNCATE,
+	STATS_UTIMENS,
+	STATS_OPEN,
+	STATS_CREATE,
+	STATS_READ,
+	STATS_WRITE,
+	STATS_COPY_FILE_RANGE,
+	STATS_FLUSH,
+	STATS_FSYNC,
+	STATS_RELEASE,
+	STATS_OPENDIR,
+	STATS_READDIR,
+	STATS_READDIRPLUS,
+	STATS_RELEASEDIR,
+	STATS_ACCESS,
+	STATS_SETXATTR,
+	STATS_GETXATTR,
+	STATS_LISTXATTR,
+	STATS_REMOVEXATTR,
+	STATS_STATFS,
+	STATS_OPS
+};
+
+/* EVENTS COUNTED */
+enum stats_counter {
+	STATS_PATHCACHE_HIT = 0,
+	STATS_PATHCACHE_MISS,
+	STATS_STATCACHE_HIT,
+	STATS_STATCACHE_MISS,
+	STATS_SUGGESTCACHE_HIT,
+	STATS_SUGGESTCACHE_MISS,
+	STATS_NAMEFILTER_HIT,  /* name surely not in catalog */
+	STATS_NAMEFILTER_MISS, /* name looked up in database */
+	STATS_COUNTERS
+};
+
+/*
+ * monotonic time in nanoseconds
+ */
+uint64_t stats_now(void);
+
+/*
+ * start timing operation served by this thread
+ */
+uint64_t stats_start(int op);
+
+/*
+ * count error of operation being served by this thread
+ */
+void stats_error(void);
+
+/*
+ * end timing operation started with stats_start
+ */
+void stats_end(int op, uint64_t start);
+
+/*
+ * stop serving operation started with stats_start, replied to later by
+ * another thread which times it
+ */
+void stats_detach(void);
+
+/*
+ * count statement run by this thread
+ */
+void stats_sql(void);
+
+/*
+ * count event
+ */
+void stats_count(int counter);
+
+/*
+ * record time taken by plugin to extract metadata
+ */
+void stats_plugin(const char *name, uint64_t start, int failed);
+
+/*
+ * report of all counters as text
+ */
+char *stats_report(size_t *len);
+
+#endif
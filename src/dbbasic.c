@@ -23,7 +23,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <sqlite3.h>
+#include <sys/stat.h>
 
 #include "dbbasic.h"
 #include "dbinit.h"
@@ -32,6 +36,7 @@
 #include "logging.h"
 #include "flags.h"
 #include "magicstrings.h"
+#include "stats.h"
 
 #include "metadata_extract.h"
 #include "plugins_extraction.h"
@@ -43,6 +48,634 @@
  */
 static int add_metadata_file(int fno,const char *abspath,char *fname);
 
+/*
+ * Replace size file is counted with in bytes of catalog
+ */
+static long long counted_swap(int fno, long long size, bool keep);
+
+/* ---------------- CATALOG CHANGES --------------- */
+
+static const struct catalog_listener *catalog_listener = NULL;
+static unsigned int catalog_generation = 0;
+static struct catalog_counts catalog_counts = { 0, 0, 0 };
+
+/**
+ * @struct held_change
+ * @brief notification held till the transaction making it ends
+ */
+struct held_change {
+	int tno;
+	int fno;
+	char *name;
+	struct held_change *next;
+};
+
+/**
+ * @struct held_size
+ * @brief size a file was counted with before the transaction changed it,
+ * put back if it is rolled back
+ */
+struct held_size {
+	int fno;
+	long long size;
+	bool counted; /* false if the file was not counted */
+	struct held_size *next;
+};
+
+/* changes of this thread are held, see hold_catalog_changes */
+static __thread bool catalog_held = false;
+static __thread struct held_change *held_head = NULL;
+static __thread struct held_change **held_tail = NULL;
+static __thread struct catalog_counts held_counts;
+static __thread struct held_size *held_sizes = NULL; /* latest first */
+
+/**
+ * @brief Set listener told of catalog changes
+ * @param listener - listener, NULL for none
+ * @return void
+ * @author HP
+ */
+void set_catalog_listener(const struct catalog_listener *listener)
+{
+	catalog_listener = listener;
+}
+
+/**
+ * @brief Get number changed each time the catalog changes
+ * @details lets results derived from the catalog be kept until it changes,
+ * whether or not a listener is set
+ * @param void
+ * @return generation of catalog
+ * @author HP
+ */
+unsigned int get_catalog_generation(void)
+{
+	return __atomic_load_n(&catalog_generation, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Tell listener that name appeared under or vanished from tag
+ * @param tno - tag id
+ * @param fno - file id, KW_FAIL for a tag
+ * @param name - name of tag or file
+ * @return void
+ * @author HP
+ */
+static void notify_entry(int tno, int fno, const char *name)
+{
+	struct held_change *c;
+
+	if(catalog_held) {
+		c = malloc(sizeof(struct held_change));
+		if(c == NULL || (c->name = strdup(name)) == NULL) {
+			free(c);
+			return;
+		}
+		c->tno = tno;
+		c->fno = fno;
+		c->next = NULL;
+		*held_tail = c;
+		held_tail = &c->next;
+		return;
+	}
+	__atomic_add_fetch(&catalog_generation, 1, __ATOMIC_RELEASE);
+	if(catalog_listener != NULL && catalog_listener->entry_changed != NULL){
+		catalog_listener->entry_changed(tno, fno, name);
+	}
+}
+
+/**
+ * @brief Hold notifications and counts of changes made by this thread
+ * @details for changes made in a transaction, which other connections do
+ * not see before it commits. Invalidating the kernel before that would let
+ * it look the names up again and cache what is being replaced.
+ * @param void
+ * @return void
+ * @see release_catalog_changes
+ * @author HP
+ */
+void hold_catalog_changes(void)
+{
+	memset(&held_counts, 0, sizeof(struct catalog_counts));
+	held_head = NULL;
+	held_tail = &held_head;
+	held_sizes = NULL;
+	catalog_held = true;
+}
+
+/**
+ * @brief Send or drop changes held since hold_catalog_changes
+ * @details when dropped, sizes files were counted with are put back, as a
+ * file id freed by the rollback is handed out again
+ * @param applied - true if the transaction committed, false if it was
+ * rolled back and nothing changed
+ * @return void
+ * @author HP
+ */
+void release_catalog_changes(bool applied)
+{
+	struct held_change *c;
+	struct held_size *s;
+
+	catalog_held = false;
+	if(applied) {
+		__atomic_add_fetch(&catalog_counts.files, held_counts.files,
+		                   __ATOMIC_RELAXED);
+		__atomic_add_fetch(&catalog_counts.tags, held_counts.tags,
+		                   __ATOMIC_RELAXED);
+		__atomic_add_fetch(&catalog_counts.bytes, held_counts.bytes,
+		                   __ATOMIC_RELAXED);
+		__atomic_add_fetch(&catalog_generation, 1, __ATOMIC_RELEASE);
+	}
+	while((c = held_head) != NULL) {
+		held_head = c->next;
+		if(applied) {
+			notify_entry(c->tno, c->fno, c->name);
+		}
+		free(c->name);
+		free(c);
+	}
+	while((s = held_sizes) != NULL) {
+		held_sizes = s->next;
+		if(!applied) {
+			counted_swap(s->fno, s->size, s->counted);
+		}
+		free(s);
+	}
+}
+
+/**
+ * @brief Get tags holding a name about to be removed, to notify later
+ * @param query - query selecting tag ids holding name
+ * @param count - set to number of tag ids
+ * @return array of tag ids : SUCCESS, NULL : no listener or FAIL
+ * @see notify_entries
+ * @author HP
+ */
+static int *select_holders(const char *query, int *count)
+{
+	sqlite3_stmt *stmt;
+	int *ids = NULL, *tmp;
+	int size = 0;
+
+	*count = 0;
+	if(catalog_listener == NULL) {
+		return NULL;
+	}
+	sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+	while(sqlite3_step(stmt) == SQLITE_ROW) {
+		if(*count == size) {
+			size = (size == 0) ? 8 : size * 2;
+			tmp = realloc(ids, size * sizeof(int));
+			if(tmp == NULL) {
+				break;
+			}
+			ids = tmp;
+		}
+		ids[(*count)++] = sqlite3_column_int(stmt,0);
+	}
+	sqlite3_finalize(stmt);
+	return ids;
+}
+
+/**
+ * @brief Tell listener that name vanished from tags, frees ids
+ * @param ids - tag ids from select_holders
+ * @param count - number of tag ids
+ * @param fno - file id, KW_FAIL for a tag
+ * @param name - name of tag or file
+ * @return void
+ * @author HP
+ */
+static void notify_entries(int *ids, int count, int fno, const char *name)
+{
+	int i;
+
+	if(!catalog_held) {
+		__atomic_add_fetch(&catalog_generation, 1, __ATOMIC_RELEASE);
+	}
+	for(i = 0; i < count; i++) {
+		notify_entry(ids[i], fno, name);
+	}
+	free(ids);
+}
+
+/* ---------------- CATALOG COUNTS --------------- */
+
+/**
+ * @brief Change counts of catalog, or those held by this thread
+ * @param files - files added, negative for removed
+ * @param tags - tags added, negative for removed
+ * @param bytes - bytes added, negative for removed
+ * @return void
+ * @see hold_catalog_changes
+ * @author HP
+ */
+static void count_change(long long files, long long tags, long long bytes)
+{
+	if(catalog_held) {
+		held_counts.files += files;
+		held_counts.tags += tags;
+		held_counts.bytes += bytes;
+		return;
+	}
+	__atomic_add_fetch(&catalog_counts.files, files, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&catalog_counts.tags, tags, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&catalog_counts.bytes, bytes, __ATOMIC_RELAXED);
+}
+
+/* SIZES OF FILES AS COUNTED IN BYTES OF CATALOG */
+#define COUNTED_BUCKETS 4096
+
+/**
+ * @struct counted_size
+ * @brief size a file was last counted with
+ */
+struct counted_size {
+	int fno;
+	long long size;
+	struct counted_size *next;
+};
+
+static struct counted_size *counted_sizes[COUNTED_BUCKETS];
+static pthread_mutex_t counted_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Replace size file is counted with
+ * @details the size replaced is held by a thread holding its changes, to
+ * be put back by release_catalog_changes
+ * @param fno - file id
+ * @param size - size to count file with
+ * @param keep - false to forget the file, as it is removed
+ * @return size file was counted with before, 0 if it was not counted
+ * @author HP
+ */
+static long long counted_swap(int fno, long long size, bool keep)
+{
+	struct counted_size **p, *c;
+	struct held_size *s;
+	long long old = 0;
+
+	pthread_mutex_lock(&counted_lock);
+	for(p = &counted_sizes[fno % COUNTED_BUCKETS]; *p != NULL;
+	    p = &(*p)->next) {
+		if((*p)->fno == fno) {
+			break;
+		}
+	}
+	c = *p;
+	if(catalog_held && (s = malloc(sizeof(struct held_size))) != NULL) {
+		s->fno = fno;
+		s->size = (c != NULL) ? c->size : 0;
+		s->counted = (c != NULL);
+		s->next = held_sizes;
+		held_sizes = s;
+	}
+	if(c != NULL) {
+		old = c->size;
+		if(keep) {
+			c->size = size;
+		} else {
+			*p = c->next;
+			free(c);
+		}
+	} else if(keep && (c = malloc(sizeof(struct counted_size))) != NULL) {
+		c->fno = fno;
+		c->size = size;
+		c->next = NULL;
+		*p = c;
+	}
+	pthread_mutex_unlock(&counted_lock);
+	return old;
+}
+
+/**
+ * @brief Count file being added or removed
+ * @param fno - file id
+ * @param abspath - absolute path of file
+ * @param sign - 1 for added, -1 for removed
+ * @note a removed file takes away the size it was counted with, whatever
+ * its size on disk is by then, so that bytes never drift
+ * @return void
+ * @author HP
+ */
+static void count_file(int fno, const char *abspath, int sign)
+{
+	struct stat st;
+	long long size = 0;
+
+	if(sign > 0 && stat(abspath, &st) == 0) {
+		size = st.st_size;
+	}
+	count_change(sign, 0, size - counted_swap(fno, size, sign > 0));
+}
+
+/**
+ * @brief Count new size of file, once it was written or truncated
+ * @param fno - file id
+ * @param size - size of file on disk
+ * @return void
+ * @author HP
+ */
+void count_file_size(int fno, long long size)
+{
+	if(fno < 0) {
+		return;
+	}
+	count_change(0, 0, size - counted_swap(fno, size, true));
+}
+
+/**
+ * @brief Count files, tags and bytes of files in kwest
+ * @details scans the catalog once, add_file, remove_file, add_tag and
+ * remove_tag keep the counts up to date after that
+ * @param void
+ * @return KW_SUCCESS: SUCCESS, KW_ERROR: ERROR
+ * @author HP
+ */
+int load_catalog_counts(void)
+{
+	sqlite3_stmt *stmt;
+	struct stat st;
+	long long files = 0, tags = 0, bytes = 0;
+
+	if(sqlite3_prepare_v2(get_kwdb(),"select count(*) from TagDetails;",
+	                      -1,&stmt,0) != SQLITE_OK) {
+		return KW_ERROR;
+	}
+	if(sqlite3_step(stmt) == SQLITE_ROW) {
+		tags = sqlite3_column_int64(stmt,0);
+	}
+	sqlite3_finalize(stmt);
+
+	if(sqlite3_prepare_v2(get_kwdb(),"select fno,abspath from FileDetails;",
+	                      -1,&stmt,0) != SQLITE_OK) {
+		return KW_ERROR;
+	}
+	while(sqlite3_step(stmt) == SQLITE_ROW) {
+		files++;
+		if(stat((const char *)sqlite3_column_text(stmt,1),&st) == 0) {
+			bytes += st.st_size;
+			counted_swap(sqlite3_column_int(stmt,0), st.st_size,
+			             true);
+		}
+	}
+	sqlite3_finalize(stmt);
+
+	__atomic_store_n(&catalog_counts.files, files, __ATOMIC_RELAXED);
+	__atomic_store_n(&catalog_counts.tags, tags, __ATOMIC_RELAXED);
+	__atomic_store_n(&catalog_counts.bytes, bytes, __ATOMIC_RELAXED);
+	return KW_SUCCESS;
+}
+
+/**
+ * @brief Get counts of catalog without querying database
+ * @param counts - filled with counts
+ * @return void
+ * @author HP
+ */
+void get_catalog_counts(struct catalog_counts *counts)
+{
+	counts->files = __atomic_load_n(&catalog_counts.files,
+	                                __ATOMIC_RELAXED);
+	counts->tags = __atomic_load_n(&catalog_counts.tags, __ATOMIC_RELAXED);
+	counts->bytes = __atomic_load_n(&catalog_counts.bytes,
+	                                __ATOMIC_RELAXED);
+}
+
+/* ---------------- CATALOG NAMES ---------------- */
+
+/* BLOOM FILTER OF NAMES OF TAGS AND FILES */
+#define NAMES_MIN    65536 /* names the filter is sized for at the least */
+#define NAMES_BITS   10    /* bits per name, about 1% false positives */
+#define NAMES_HASHES 7     /* bits set per name */
+
+/**
+ * @struct catalog_names
+ * @brief bits of filter, of which mask + 1 is a power of two
+ */
+struct catalog_names {
+	uint64_t mask;
+	uint64_t *bits;
+};
+
+static struct catalog_names *catalog_names = NULL;
+
+/**
+ * @brief Hash name for filter
+ * @param name - name of tag or file
+ * @param step - set to step between bits of name, always odd
+ * @return first bit of name
+ * @note FNV-1a, with its high half mixed into the step so that the bits
+ * of a name are spread over the whole filter
+ * @author HP
+ */
+static uint64_t names_hash(const char *name, uint64_t *step)
+{
+	uint64_t h = 14695981039346656037ULL;
+
+	for(; *name != '\0'; name++) {
+		h ^= (unsigned char)*name;
+		h *= 1099511628211ULL;
+	}
+	*step = ((h >> 32) * 0x9e3779b97f4a7c15ULL) | 1;
+	return h;
+}
+
+/**
+ * @brief Add name to filter of catalog names
+ * @param name - name of tag or file
+ * @return void
+ * @note names added before the filter is built are found by its scan
+ * @author HP
+ */
+static void names_add(const char *name)
+{
+	struct catalog_names *f;
+	uint64_t bit, step;
+	int i;
+
+	f = __atomic_load_n(&catalog_names, __ATOMIC_ACQUIRE);
+	if(f == NULL || name == NULL) {
+		return;
+	}
+	bit = names_hash(name, &step);
+	for(i = 0; i < NAMES_HASHES; i++, bit += step) {
+		__atomic_fetch_or(&f->bits[(bit & f->mask) >> 6],
+		                  1ULL << (bit & 63), __ATOMIC_RELEASE);
+	}
+}
+
+/**
+ * @brief Build filter of names of tags and files in kwest
+ * @details scans the catalog once, add_tag, add_file and rename_file add
+ * the names they give after that. Names are never taken out, so names of
+ * removed tags and files only make the filter answer maybe, and it never
+ * answers no for a name in the catalog.
+ * @param void
+ * @return KW_SUCCESS: SUCCESS, KW_ERROR: ERROR
+ * @note sized for twice the names found, to leave room for those added
+ * while mounted
+ * @author HP
+ */
+int load_catalog_names(void)
+{
+	const char *scans[] = { "select tagname from TagDetails;",
+	                        "select fname from FileDetails;" };
+	struct catalog_names *f;
+	struct catalog_counts counts;
+	sqlite3_stmt *stmt;
+	uint64_t names, nbits = 64;
+	unsigned int i;
+
+	get_catalog_counts(&counts);
+	names = 2 * (counts.files + counts.tags);
+	if(names < NAMES_MIN) {
+		names = NAMES_MIN;
+	}
+	while(nbits < names * NAMES_BITS) {
+		nbits <<= 1;
+	}
+
+	f = malloc(sizeof(struct catalog_names));
+	if(f == NULL) {
+		return KW_ERROR;
+	}
+	f->mask = nbits - 1;
+	f->bits = calloc(nbits / 64, sizeof(uint64_t));
+	if(f->bits == NULL) {
+		free(f);
+		return KW_ERROR;
+	}
+	__atomic_store_n(&catalog_names, f, __ATOMIC_RELEASE);
+
+	for(i = 0; i < sizeof(scans) / sizeof(scans[0]); i++) {
+		if(sqlite3_prepare_v2(get_kwdb(),scans[i],-1,&stmt,0)
+		   != SQLITE_OK) {
+			/* a partial filter would answer no for known names */
+			__atomic_store_n(&catalog_names, NULL,
+			                 __ATOMIC_RELEASE);
+			free(f->bits);
+			free(f);
+			return KW_ERROR;
+		}
+		while(sqlite3_step(stmt) == SQLITE_ROW) {
+			names_add((const char *)sqlite3_column_text(stmt,0));
+		}
+		sqlite3_finalize(stmt);
+	}
+	return KW_SUCCESS;
+}
+
+/**
+ * @brief Check if name may be that of a tag or file in kwest
+ * @param name - name of tag or file
+ * @return false if no tag or file has the name, true if one may have it
+ * @note true for every name until the filter is built
+ * @author HP
+ */
+bool catalog_may_have(const char *name)
+{
+	struct catalog_names *f;
+	uint64_t bit, step, word;
+	int i;
+
+	f = __atomic_load_n(&catalog_names, __ATOMIC_ACQUIRE);
+	if(f == NULL || name == NULL) {
+		return true;
+	}
+	bit = names_hash(name, &step);
+	for(i = 0; i < NAMES_HASHES; i++, bit += step) {
+		word = __atomic_load_n(&f->bits[(bit & f->mask) >> 6],
+		                       __ATOMIC_ACQUIRE);
+		if((word & (1ULL << (bit & 63))) == 0) {
+			stats_count(STATS_NAMEFILTER_HIT);
+			return false;
+		}
+	}
+	stats_count(STATS_NAMEFILTER_MISS);
+	return true;
+}
+
+/* ---------------- CATALOG GENERATIONS ---------------- */
+
+/* ID GENERATIONS, counted for ids given to new tags and files */
+#define GENERATION_BUCKETS 1024
+
+/**
+ * @struct id_generation
+ * @brief times id was given to a new tag or file since kwest started
+ */
+struct id_generation {
+	int key;   /* id * 2, plus 1 for files */
+	unsigned int generation;
+	struct id_generation *next;
+};
+
+static struct id_generation *id_generations[GENERATION_BUCKETS];
+static pthread_mutex_t generation_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Get or bump generation of id
+ * @param key - id * 2, plus 1 for files
+ * @param bump - true when id is given to a new tag or file
+ * @return generation of id, 0 if it was never given out since start
+ * @author HP
+ */
+static unsigned int id_generation(int key, bool bump)
+{
+	struct id_generation *g;
+	unsigned int generation = 0;
+
+	pthread_mutex_lock(&generation_lock);
+	for(g = id_generations[key % GENERATION_BUCKETS]; g != NULL;
+	    g = g->next) {
+		if(g->key == key) {
+			break;
+		}
+	}
+	if(g == NULL && bump &&
+	   (g = calloc(1, sizeof(struct id_generation))) != NULL) {
+		g->key = key;
+		g->next = id_generations[key % GENERATION_BUCKETS];
+		id_generations[key % GENERATION_BUCKETS] = g;
+	}
+	if(g != NULL) {
+		if(bump) {
+			g->generation++;
+		}
+		generation = g->generation;
+	}
+	pthread_mutex_unlock(&generation_lock);
+	return generation;
+}
+
+/**
+ * @brief Get generation of tag id
+ * @details ids of removed tags and files are given out again, the
+ * generation tells apart those holding an id in turn, so that entries
+ * cached by the kernel for the old one are not taken for the new one
+ * @param tno - tag id
+ * @return generation of tag id
+ * @author HP
+ */
+unsigned int get_tag_generation(int tno)
+{
+	return id_generation(tno * 2, false);
+}
+
+/**
+ * @brief Get generation of file id
+ * @param fno - file id
+ * @return generation of file id
+ * @see get_tag_generation
+ * @author HP
+ */
+unsigned int get_file_generation(int fno)
+{
+	return id_generation(fno * 2 + 1, false);
+}
+
 /* ---------------- ADD/REMOVE -------------------- */
 
 /**
@@ -52,7 +685,7 @@ static int add_metadata_file(int fno,const char *abspath,char *fname);
  * @param tagtype systemtag / usertag
  * @return KW_SUCCESS on SUCCESS
  * @return KW_FAIL on FAIL
- * @return KW_ERROR on ERROR
+ * @return KW_ERROR on ERROR, as for names of virtual tags of root
  * @author SG
  * @see add_association
  */
@@ -63,6 +696,12 @@ int add_tag(const char *tagname,int tagtype)
 	int status;
 	int tno; /* Tag ID */
 
+	/* Names of virtual tags of used files, a tag would be hidden by */
+	if(strcmp(tagname,RECENT_DIR) == 0 || strcmp(tagname,FREQUENT_DIR) == 0){
+		log_msg("add_tag : %s%s",ERR_TAG_RESERVED,tagname);
+		return KW_ERROR;
+	}
+
 	/* Call Function to set tno for Tag */
 	if(tagtype == USER_TAG){
 		tno = set_tag_id(tagname,USER_TAG); /* Add User Tag */
@@ -76,6 +715,9 @@ int add_tag(const char *tagname,int tagtype)
 		return KW_ERROR;
 	}
 
+	names_add(tagname); /* before the insert, so it is never missed */
+	id_generation(tno * 2, true); /* nor looked up with the old one */
+
 	/* Insert (tno, tagname) in TagDetails Table */
 	strcpy(query,"insert into TagDetails values(:tno,:tagname);");
 	sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
@@ -86,6 +728,9 @@ int add_tag(const char *tagname,int tagtype)
 	status = sqlite3_step(stmt);
 	if(status == SQLITE_DONE){
 		sqlite3_finalize(stmt);
+		count_change(0, 1, 0);
+		/* Any tag can be looked up under root, bumps generation */
+		notify_entry(get_tag_id(TAG_ROOT), KW_FAIL, tagname);
 		return KW_SUCCESS;
 	}
 
@@ -104,6 +749,7 @@ int remove_tag(const char *tagname)
 	char query[QUERY_SIZE];
 	int status;
 	int tno;
+	int *holders, count;
 
 	tno = get_tag_id(tagname); /* Get Tag ID */
 
@@ -113,6 +759,11 @@ int remove_tag(const char *tagname)
 		return KW_ERROR;
 	}
 
+	/* Tags it is grouped under, to be notified */
+	sprintf(query,"select t2 from TagAssociation where t1 = %d "
+	              "and associationid = %d;",tno,ASSOC_SUBGROUP);
+	holders = select_holders(query, &count);
+
 	/* Remove all Tag-Tag Associations */
 	sprintf(query,"delete from TagAssociation where t1 = %d or t2 = %d;",
 	        tno,tno);
@@ -125,6 +776,15 @@ int remove_tag(const char *tagname)
 	/* Remove all Tag from database */
 	sprintf(query,"delete from TagDetails where tno = %d;",tno);
 	status = sqlite3_exec(get_kwdb(),query,0,0,0);
+	if(status == SQLITE_OK) {
+		count_change(0, -1, 0);
+	}
+
+	/* Tag vanishes from root and tags it was grouped under */
+	notify_entries(holders, count, KW_FAIL, tagname);
+	if(catalog_listener != NULL) {
+		notify_entry(get_tag_id(TAG_ROOT), KW_FAIL, tagname);
+	}
 
 	if(status == SQLITE_OK){
 		return KW_SUCCESS;
@@ -134,12 +794,13 @@ int remove_tag(const char *tagname)
 }
 
 /**
- * @brief Add file to kwest
+ * @brief Add file to kwest, without its metadata
  * @param abspath
+ * @param id set to id of file added
  * @return KW_SUCCESS: SUCCESS, KW_FAIL: FAIL, KW_ERROR: ERROR
  * @author SG
  */
-int add_file(const char *abspath)
+static int insert_file(const char *abspath, int *id)
 {
 	sqlite3_stmt *stmt;
 	char query[QUERY_SIZE];
@@ -154,6 +815,9 @@ int add_file(const char *abspath)
 		return KW_ERROR;
 	}
 
+	names_add(fname); /* before the insert, so it is never missed */
+	id_generation(fno * 2 + 1, true); /* nor looked up with the old one */
+
 	/* Query : Insert (fno, fname, abspath) in FileDetails Table */
 	strcpy(query,"insert into FileDetails values(:fno,:fname,:abspath);");
 	sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
@@ -170,14 +834,91 @@ int add_file(const char *abspath)
 	}
 
 	sqlite3_finalize(stmt);
-	/* Get Metadata for file */
-	add_metadata_file(fno,abspath,fname);
+	count_file(fno, abspath, 1);
+	*id = fno;
 
-	if(status == SQLITE_DONE){
-		return KW_SUCCESS;
+	return KW_SUCCESS;
+}
+
+/**
+ * @brief Add file to kwest
+ * @param abspath
+ * @return KW_SUCCESS: SUCCESS, KW_FAIL: FAIL, KW_ERROR: ERROR
+ * @author SG
+ */
+int add_file(const char *abspath)
+{
+	int status;
+	int fno;
+
+	status = insert_file(abspath, &fno);
+	if(status == KW_SUCCESS) { /* Get Metadata for file */
+		add_metadata_file(fno,abspath,strrchr(abspath,'/')+1);
 	}
 
-	return KW_FAIL;
+	return status;
+}
+
+/**
+ * @brief Add file to kwest, its metadata to be added by add_file_metadata
+ * @param abspath
+ * @return KW_SUCCESS: SUCCESS, KW_FAIL: FAIL, KW_ERROR: ERROR
+ * @note used for files created empty, whose metadata is only known once
+ * they are written
+ * @author HP
+ */
+int add_new_file(const char *abspath)
+{
+	int fno;
+
+	return insert_file(abspath, &fno);
+}
+
+/**
+ * @brief Extract and add metadata for file in kwest from its contents
+ * @details metadata tags the file was under from an earlier extraction
+ * are removed first, so that a file rewritten with other metadata does
+ * not stay under its old values. Tags made by the user are kept.
+ * @param fno - file id
+ * @return KW_SUCCESS: SUCCESS, KW_FAIL: FAIL, KW_ERROR: ERROR
+ * @see ingest.c
+ * @author HP
+ */
+int add_file_metadata(int fno)
+{
+	char query[QUERY_SIZE];
+	char *abspath;
+	int status;
+	int *holders, count;
+
+	abspath = get_abspath_by_fno(fno);
+	if(abspath == NULL) {
+		return KW_FAIL;
+	}
+
+	/* Metadata tags of file, values of categories in MetaInfo */
+	sprintf(query,"select tno from FileAssociation where fno = %d "
+	              "and tno < %d and tno in (select t1 from "
+	              "TagAssociation where associationid = %d and t2 in "
+	              "(select tno from TagDetails where tagname in "
+	              "(select tag from MetaInfo)));",
+	              fno, USER_MADE_TAG, ASSOC_SUBGROUP);
+	holders = select_holders(query, &count);
+
+	/* Remove them, to be added again as extracted now */
+	sprintf(query,"delete from FileAssociation where fno = %d "
+	              "and tno < %d and tno in (select t1 from "
+	              "TagAssociation where associationid = %d and t2 in "
+	              "(select tno from TagDetails where tagname in "
+	              "(select tag from MetaInfo)));",
+	              fno, USER_MADE_TAG, ASSOC_SUBGROUP);
+	sqlite3_exec(get_kwdb(),query,0,0,0);
+	notify_entries(holders, count, fno, strrchr(abspath,'/')+1);
+
+	status = add_metadata_file(fno,abspath,strrchr(abspath,'/')+1);
+	free(abspath);
+
+	return status;
 }
 
 /**
@@ -268,6 +1009,7 @@ int remove_file(const char *abspath)
 	char query[QUERY_SIZE];
 	int status;
 	int fno;
+	int *holders, count;
 
 	fno = get_file_id(strrchr(abspath,'/') + 1); /* Get File ID */
 
@@ -276,10 +1018,18 @@ int remove_file(const char *abspath)
 		return KW_ERROR;
 	}
 
+	/* Tags it is under, to be notified */
+	sprintf(query,"select tno from FileAssociation where fno = %d;",fno);
+	holders = select_holders(query, &count);
+
 	/* Remove File-Tag Associations */
 	sprintf(query,"delete from FileAssociation where fno = %d;",fno);
 	sqlite3_exec(get_kwdb(),query,0,0,0);
 
+	/* Remove uses of File, see dbusage.c */
+	sprintf(query,"delete from FileUsage where fno = %d;",fno);
+	sqlite3_exec(get_kwdb(),query,0,0,0);
+
 	/** @todo Generalize structure to remove file medatata */
 	/* Remove File-metadata from Database */
 	/* sprintf(query,"delete from Audio where fno = %d;",fno);
@@ -288,6 +1038,12 @@ int remove_file(const char *abspath)
 	/* Remove File from Database */
 	sprintf(query,"delete from FileDetails where fno = %d;",fno);
 	status = sqlite3_exec(get_kwdb(),query,0,0,0);
+	if(status == SQLITE_OK) {
+		count_file(fno, abspath, -1);
+	}
+
+	/* File vanishes from tags it was under */
+	notify_entries(holders, count, fno, strrchr(abspath,'/') + 1);
 
 	if(status == SQLITE_OK){
 		return KW_SUCCESS;
@@ -385,6 +1141,7 @@ int tag_file(const char *t,const char *f)
 		status = sqlite3_exec(get_kwdb(),query,0,0,0);
 
 		if(status == SQLITE_OK){
+			notify_entry(tno, fno, f);
 			return KW_SUCCESS;
 		}
 	}
@@ -430,6 +1187,7 @@ int untag_file(const char *t,const char *f)
 		return KW_FAIL;
 	}
 	log_msg("untag operation success");
+	notify_entry(tno, fno, f);
 
 	/* Remove file if not under any tag */
 	sprintf(query,"select count(*) from FileAssociation where fno = %d;"
@@ -588,6 +1346,139 @@ sqlite3_stmt *get_tags_for_file(const char *f)
 	return stmt;
 }
 
+/**
+ * @brief Return names of tags associated with file given by id
+ * @param fno - file id
+ * @return comma separated tag names : SUCCESS, NULL : FAIL
+ * @note returned string is to be freed by caller
+ * @author HP
+ */
+char *get_file_tags(int fno)
+{
+	sqlite3_stmt *stmt;
+	char query[QUERY_SIZE];
+	const char *tag;
+	char *tags = NULL, *tmp;
+	size_t len = 0, taglen;
+
+	/* Query to get all tags associated with file fno */
+	sprintf(query,"select tagname from TagDetails where tno in"
+	        "(select tno from FileAssociation where fno = %d)"
+	        " order by tno;",fno);
+	if(sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0) != SQLITE_OK){
+		log_msg("get_file_tags : %s",ERR_PREP_QUERY);
+		return NULL;
+	}
+
+	tags = strdup("");
+	while(tags != NULL && sqlite3_step(stmt) == SQLITE_ROW) {
+		tag = (const char*)sqlite3_column_text(stmt,0);
+		taglen = strlen(tag);
+		tmp = realloc(tags, len + taglen + 2);
+		if(tmp == NULL) {
+			free(tags);
+			tags = NULL;
+			break;
+		}
+		tags = tmp;
+		if(len > 0) {
+			tags[len++] = ',';
+		}
+		strcpy(tags + len, tag);
+		len += taglen;
+	}
+	sqlite3_finalize(stmt);
+
+	return tags;
+}
+
+/**
+ * @brief Replace tags associated with file given by id
+ * @details all tags must exist, and the file is associated with exactly
+ * these tags in a single transaction, or left as it was
+ * @param fno - file id
+ * @param tags - comma separated tag names
+ * @return KW_SUCCESS: SUCCESS, KW_FAIL: FAIL, KW_ERROR: ERROR
+ * @author HP
+ */
+int set_file_tags(int fno, const char *tags)
+{
+	char query[QUERY_SIZE];
+	char *copy, *tag, *saveptr = NULL;
+	const char *fname;
+	int *tnos = NULL, *tmp;
+	int *old = NULL;
+	int count = 0, size = 0, oldcount = 0;
+	int status = KW_SUCCESS;
+	int i;
+
+	/* Resolve all tags before changing anything */
+	copy = strdup(tags);
+	if(copy == NULL) {
+		return KW_FAIL;
+	}
+	for(tag = strtok_r(copy, ",\n", &saveptr); tag != NULL;
+	    tag = strtok_r(NULL, ",\n", &saveptr)) {
+		if(count == size) {
+			size = (size == 0) ? 8 : size * 2;
+			tmp = realloc(tnos, size * sizeof(int));
+			if(tmp == NULL) {
+				status = KW_FAIL;
+				break;
+			}
+			tnos = tmp;
+		}
+		if((tnos[count++] = get_tag_id(tag)) == KW_FAIL) {
+			log_msg("set_file_tags : %s%s",ERR_TAG_NOT_FOUND,tag);
+			status = KW_ERROR;
+			break;
+		}
+	}
+	free(copy);
+	if(status != KW_SUCCESS || count == 0) {
+		free(tnos);
+		return (status == KW_SUCCESS) ? KW_ERROR : status;
+	}
+
+	sprintf(query,"select tno from FileAssociation where fno = %d;",fno);
+	old = select_holders(query, &oldcount);
+
+	/* Query : replace File Association rows of fno */
+	begin_transaction();
+	sprintf(query,"delete from FileAssociation where fno = %d;",fno);
+	if(sqlite3_exec(get_kwdb(),query,0,0,0) != SQLITE_OK) {
+		status = KW_FAIL;
+	}
+	for(i = 0; i < count && status == KW_SUCCESS; i++) {
+		sprintf(query,"insert into FileAssociation select %d,%d where "
+		        "not exists (select 1 from FileAssociation where "
+		        "tno = %d and fno = %d);",tnos[i],fno,tnos[i],fno);
+		if(sqlite3_exec(get_kwdb(),query,0,0,0) != SQLITE_OK) {
+			status = KW_FAIL;
+		}
+	}
+	if(status != KW_SUCCESS || commit_transaction() != SQLITE_OK) {
+		log_msg("set_file_tags : could not retag %d",fno);
+		rollback_transaction();
+		free(old);
+		free(tnos);
+		return KW_FAIL;
+	}
+
+	fname = get_file_name(fno);
+	if(fname != NULL) {
+		notify_entries(old, oldcount, fno, fname);
+		for(i = 0; i < count; i++) {
+			notify_entry(tnos[i], fno, fname);
+		}
+		free((char *)fname);
+	} else {
+		free(old);
+	}
+	free(tnos);
+	return KW_SUCCESS;
+}
+
 
 /*----------------- Tag-Tag Relation ------------------*/
 
@@ -633,6 +1524,9 @@ int add_association(const char *t1,const char *t2,int associationid)
 	status = sqlite3_exec(get_kwdb(),query,0,0,0);
 
 	if(status == SQLITE_OK){
+		if(associationid == ASSOC_SUBGROUP) {
+			notify_entry(t2_id, KW_FAIL, t1);
+		}
 		return KW_SUCCESS;
 	}
 
@@ -678,6 +1572,9 @@ int remove_association(const char *t1,const char *t2,int associationid)
 	status = sqlite3_exec(get_kwdb(),query,0,0,0);
 
 	if(status == SQLITE_OK){
+		if(associationid == ASSOC_SUBGROUP) {
+			notify_entry(t2_id, KW_FAIL, t1);
+		}
 		return KW_SUCCESS;
 	}
 
@@ -1032,6 +1929,244 @@ char *get_abspath_by_fname(const char *fname)
 	return NULL;
 }
 
+/**
+ * @brief Return absolute path of file by its id
+ * @param fno - file id
+ * @return absolute path : SUCCESS, NULL : FAIL
+ * @author HP
+ */
+char *get_abspath_by_fno(int fno)
+{
+	sqlite3_stmt *stmt;
+	char query[QUERY_SIZE];
+	int status;
+	char *abspath;
+
+	/* Query to get absolute path from file id */
+	strcpy(query,"select abspath from FileDetails where fno = :fno;");
+	sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+	sqlite3_bind_int(stmt,1,fno);
+
+	status = sqlite3_step(stmt);
+	if(status == SQLITE_ROW) {
+		abspath = strdup((const char*)sqlite3_column_text(stmt,0));
+		sqlite3_finalize(stmt);
+		return abspath;
+	}
+
+	sqlite3_finalize(stmt);
+	return NULL;
+}
+
+/**
+ * @brief Check if file is associated with tag, both given by id
+ * @param fno - file id
+ * @param tno - tag id
+ * @return true if file is tagged, false otherwise
+ * @author HP
+ */
+bool is_file_tagged_id(int fno, int tno)
+{
+	sqlite3_stmt *stmt;
+	char query[QUERY_SIZE];
+	int status;
+
+	sprintf(query, "select count(*) from FileAssociation where tno = %d"
+	               " and fno = %d;", tno, fno);
+	sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+
+	status = sqlite3_step(stmt);
+	if(status == SQLITE_ROW) {
+		status = sqlite3_column_int(stmt,0);
+		sqlite3_finalize(stmt);
+		return (status > 0);
+	}
+
+	sqlite3_finalize(stmt);
+	return false;
+}
+
+/**
+ * @brief Return type of association between two tags given by id
+ * @param t1,t2 - tag ids of both tags in association
+ * @return associationid : SUCCESS, KW_FAIL : FAIL
+ * @author HP
+ */
+int get_association_id(int t1, int t2)
+{
+	sqlite3_stmt *stmt;
+	char query[QUERY_SIZE];
+	int status;
+
+	sprintf(query,"select associationid from TagAssociation where "
+	              "t1 = %d and t2 = %d;", t1, t2);
+	sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+
+	status = sqlite3_step(stmt);
+	if(status == SQLITE_ROW) {
+		status = sqlite3_column_int(stmt,0);
+		sqlite3_finalize(stmt);
+		return status;
+	}
+
+	sqlite3_finalize(stmt);
+	return KW_FAIL;
+}
+
+/**
+ * @brief Return id and name of tags grouped under given tag
+ * @param tno - tag id
+ * @param from - smallest tag id returned
+ * @return sqlite3_stmt pointer : SUCCESS, NULL : FAIL
+ * @note rows are in order of tag id, so a listing can be resumed from the
+ * id following the last one returned
+ * @see row_from_stmt
+ * @author HP
+ */
+sqlite3_stmt *get_subtags_by_tno(int tno, int from)
+{
+	sqlite3_stmt *stmt;
+	char query[QUERY_SIZE];
+	int status;
+
+	sprintf(query,"select tno,tagname from TagDetails where tno in"
+	              "(select t1 from TagAssociation where "
+	              "t2 = %d and associationid = %d) and tno >= %d "
+	              "order by tno;",
+	              tno, ASSOC_SUBGROUP, from);
+	status = sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+
+	if(status != SQLITE_OK){ /* Error Preparing query */
+		log_msg("get_subtags_by_tno : %s",ERR_PREP_QUERY);
+		return NULL;
+	}
+
+	return stmt;
+}
+
+/**
+ * @brief Return id, name and absolute path of files associated to given tag
+ * @param tno - tag id
+ * @param from - smallest file id returned
+ * @return sqlite3_stmt pointer : SUCCESS, NULL : FAIL
+ * @note rows are in order of file id and walk the FileAssociation index,
+ * so a listing can be resumed from the id following the last one returned
+ * @see row_from_stmt
+ * @author HP
+ */
+sqlite3_stmt *get_files_by_tno(int tno, int from)
+{
+	return get_files_by_tno_range(tno, from, INT_MAX);
+}
+
+/**
+ * @brief Return id, name and absolute path of files associated to given tag
+ * with ids in a range
+ * @param tno - tag id
+ * @param from - smallest file id returned
+ * @param to - largest file id returned
+ * @return sqlite3_stmt pointer : SUCCESS, NULL : FAIL
+ * @note the range is one walk of the FileAssociation index, so its cost
+ * depends on the files in range and not on the files under tag
+ * @see get_files_by_tno
+ * @author HP
+ */
+sqlite3_stmt *get_files_by_tno_range(int tno, int from, int to)
+{
+	sqlite3_stmt *stmt;
+	char query[QUERY_SIZE];
+	int status;
+
+	sprintf(query,"select FileDetails.fno,fname,abspath from "
+	              "FileAssociation join FileDetails on FileDetails.fno = "
+	              "FileAssociation.fno where tno = %d and "
+	              "FileAssociation.fno >= %d and FileAssociation.fno <= %d "
+	              "order by FileAssociation.fno;",
+	              tno, from, to);
+	status = sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+
+	if(status != SQLITE_OK){ /* Error Preparing query */
+		log_msg("get_files_by_tno_range : %s",ERR_PREP_QUERY);
+		return NULL;
+	}
+
+	return stmt;
+}
+
+/**
+ * @brief Return smallest id of file associated to given tag, from given id
+ * @param tno - tag id
+ * @param from - smallest file id looked at
+ * @return fno : SUCCESS, KW_FAIL : no such file
+ * @note answered by a single seek of the FileAssociation index
+ * @author HP
+ */
+int get_next_fno_by_tno(int tno, int from)
+{
+	sqlite3_stmt *stmt;
+	char query[QUERY_SIZE];
+	int fno = KW_FAIL;
+
+	sprintf(query,"select min(fno) from FileAssociation where tno = %d "
+	              "and fno >= %d;", tno, from);
+	sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+
+	if(sqlite3_step(stmt) == SQLITE_ROW &&
+	   sqlite3_column_type(stmt,0) != SQLITE_NULL) {
+		fno = sqlite3_column_int(stmt,0);
+	}
+
+	sqlite3_finalize(stmt);
+	return fno;
+}
+
+/**
+ * @brief Check if more than count files are associated to given tag
+ * @param tno - tag id
+ * @param count - number of files
+ * @return true if tag has more than count files, else false
+ * @note reads at most count + 1 rows of the FileAssociation index, however
+ * many files are under tag
+ * @author HP
+ */
+bool tag_has_more_files(int tno, int count)
+{
+	sqlite3_stmt *stmt;
+	char query[QUERY_SIZE];
+	int status;
+
+	sprintf(query,"select fno from FileAssociation where tno = %d "
+	              "limit 1 offset %d;", tno, count);
+	sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+
+	status = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+	return status == SQLITE_ROW;
+}
+
+/**
+ * @brief Returns id and name for multiple rows in query
+ * @param stmt - statement selecting (id, name)
+ * @param id - set to id of current row
+ * @return name in current row : SUCCESS, NULL : end of data
+ * @note statement is finalized at end of data
+ * @author HP
+ */
+const char *row_from_stmt(sqlite3_stmt *stmt, int *id)
+{
+	if(stmt == NULL) {
+		return NULL;
+	}
+
+	if(sqlite3_step(stmt) == SQLITE_ROW){ /* Return data if present */
+		*id = sqlite3_column_int(stmt,0);
+		return (const char*)sqlite3_column_text(stmt,1);
+	}
+
+	sqlite3_finalize(stmt); /* Return NULL to mark end of Data */
+	return NULL;
+}
+
 /**
  * @brief Rename file existing in kwest
  * @param from - existing name of file
@@ -1055,6 +2190,7 @@ int rename_file(const char *from, const char *to)
 		return KW_ERROR;
 	}
 
+	names_add(to); /* before the update, so it is never missed */
 	strcpy(query,"update FileDetails set fname=:from where fno=:fno;");
 	sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
 
@@ -22,10 +22,19 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
 #include "dbfuse.h"
 #include "dbbasic.h"
+#include "dbinit.h"
+#include "dbkey.h"
+#include "dbquery.h"
+#include "dbusage.h"
+#include "fusecache.h"
+#include "fuseopts.h"
 #include "logging.h"
 #include "flags.h"
 
@@ -91,8 +100,93 @@ static int check_association(const char *path)
 	return KW_SUCCESS;
 }
 
+/**
+ * @brief remember a validated path in the path cache
+ * @param path
+ * @param kind KW_PATH_TAG or KW_PATH_FILE
+ * @return void
+ * @author HP
+ */
+static void cache_valid_path(const char *path, int kind)
+{
+	const char *name = get_entry_name(path);
+	char *abspath = NULL;
+
+	if (kind == KW_PATH_TAG) {
+		pathcache_insert(path, kind, get_tag_id(name), NULL);
+	} else {
+		abspath = get_abspath_by_fname(name);
+		pathcache_insert(path, kind, get_file_id(name), abspath);
+		free(abspath);
+	}
+}
+
+/**
+ * @brief checks whether query path is valid in database
+ * @details a query is valid if all its tags exist, and a file under it if
+ * the file satisfies the query
+ * @param path
+ * @return KW_SUCCESS: SUCCESS, KW_FAIL: FAIL
+ * @note query paths are not kept in the path cache, which forgets paths
+ * by the names of their components
+ * @author HP
+ */
+static int check_query_validity(const char *path)
+{
+	struct kw_query *q;
+	char *tmp_path;
+	int fno;
+	bool valid;
+
+	if (is_query_component(get_entry_name(path)) == true) {
+		q = query_parse(path);
+		valid = (q != NULL);
+		query_free(q);
+		return valid ? KW_SUCCESS : KW_FAIL;
+	}
+
+	tmp_path = strdup(path);
+	*strrchr(tmp_path,'/') = '\0';
+	q = query_parse(tmp_path);
+	free(tmp_path);
+	if (q == NULL) {
+		return KW_FAIL;
+	}
+	fno = get_file_id(get_entry_name(path));
+	valid = (fno != KW_FAIL && query_matches(q, fno) == true);
+	query_free(q);
+	return valid ? KW_SUCCESS : KW_FAIL;
+}
+
+/**
+ * @brief checks whether path under a virtual tag of used files is valid
+ * @param path
+ * @param kind virtual tag holding path
+ * @return KW_SUCCESS: SUCCESS, KW_FAIL: FAIL
+ * @author HP
+ */
+static int check_usage_validity(const char *path, int kind)
+{
+	const char *name = get_entry_name(path);
+	int fno;
+
+	if (strchr(path + 1, '/') == NULL) {
+		return KW_SUCCESS;
+	}
+	if (strchr(path + 1, '/') != name - 1) { /* no tags under it */
+		return KW_FAIL;
+	}
+	fno = get_file_id(name);
+	if (fno == KW_FAIL || usage_has_file(kind, fno) == false) {
+		return KW_FAIL;
+	}
+	return KW_SUCCESS;
+}
+
 /**
  * @brief checks whether current path is valid in database
+ * @details validated paths are kept in the path cache, so repeated lookups
+ * of the same path do not query the database
  * @param path
  * @return KW_SUCCESS: SUCCESS, KW_FAIL: FAIL, KW_ERROR: ERROR
  * @author HP SG
@@ -109,6 +203,19 @@ int check_path_validity(const char *path)
 		log_msg("is_root");
 		return KW_SUCCESS;
 	}
+	if (is_query_path(path) == true) {
+		return check_query_validity(path);
+	}
+	if (usage_of_path(path) != KW_FAIL) {
+		return check_usage_validity(path, usage_of_path(path));
+	}
+	if (pathcache_lookup(path, NULL, NULL) != KW_PATH_NONE) {
+		return KW_SUCCESS;
+	}
+	/* names no tag or file has are known without querying database */
+	if (catalog_may_have(get_entry_name(path)) == false) {
+		return KW_FAIL;
+	}
 	/** @bug tagname could be NULL
 	 * entry returned from here causes segmentation fault
 	 */
@@ -124,6 +231,7 @@ int check_path_validity(const char *path)
 	if (istag(get_entry_name(path)) == true) {
 		if (check_association(path) == KW_SUCCESS) {
 			log_msg("istag");
+			cache_valid_path(path, KW_PATH_TAG);
 			return KW_SUCCESS;
 		}
 	} else if (isfile(get_entry_name(path)) == true) {
@@ -137,6 +245,7 @@ int check_path_validity(const char *path)
 				return -ENOENT;
 			}
 			free((char *)tmp_path);
+			cache_valid_path(path, KW_PATH_FILE);
 			return KW_SUCCESS;
 		}
 		free((char *)tmp_path);
@@ -238,6 +347,18 @@ int check_path_tags_validity(const char *_path)
  */
 bool path_is_dir(const char *path)
 {
+	switch (pathcache_lookup(path, NULL, NULL)) {
+	case KW_PATH_TAG:
+		return true;
+	case KW_PATH_FILE:
+		return false;
+	}
+	if (is_query_path(path) == true) {
+		return is_query_component(get_entry_name(path));
+	}
+	if (usage_of_path(path) != KW_FAIL) {
+		return strchr(path + 1, '/') == NULL;
+	}
 	if (istag(get_entry_name(path)) != true)
 		return false;
 	return true;
@@ -251,6 +372,19 @@ bool path_is_dir(const char *path)
  */
 bool path_is_file(const char *path)
 {
+	switch (pathcache_lookup(path, NULL, NULL)) {
+	case KW_PATH_TAG:
+		return false;
+	case KW_PATH_FILE:
+		return true;
+	}
+	if (is_query_path(path) == true &&
+	    is_query_component(get_entry_name(path)) == true) {
+		return false;
+	}
+	if (usage_of_path(path) != KW_FAIL && strchr(path + 1, '/') == NULL) {
+		return false;
+	}
 	if (isfile(get_entry_name(path)) != true) {
 		return false;
 	}
@@ -266,6 +400,11 @@ bool path_is_file(const char *path)
  */
 const char *get_absolute_path(const char *path)
 {
+	char *abspath = NULL;
+
+	if (pathcache_lookup(path, NULL, &abspath) == KW_PATH_FILE) {
+		return abspath;
+	}
 	return get_abspath_by_fname(get_entry_name(path));
 }
 
@@ -320,28 +459,104 @@ char *readdir_files(const char *path, void **ptr)
 }
 
 /**
- * @brief create a new file and return is absolute path
+ * @brief get absolute path a new file of path is to be created at
+ * @details new files are created in the store directory, under directories
+ * named after the tags of path, which are made if missing. The file of
+ * /Music/Rock/song.mp3 is created as <store>/Music/Rock/song.mp3
  * @param path
- * @return const char * as absolute path
+ * @return const char * as absolute path, to be freed by caller
+ * @return NULL on error
+ * @see kwest_options
  * @author HP
  */
 const char *get_newfile_path(const char *path)
 {
-	/*
-	 * @HP
-	 * this function should get path to some real location
-	 * so that the new file can be created there
-	 * parse path - there will be the format
-	 * /Files/Music/tags.../filename.ext
-	 * so try to get directory /Music/tags... or something
-	 * then return that...
-	 * 
-	 * char *path = some_new_path
-	 * 
-	 * return (const char *)path;
-	 */
-	(void)path;
-	return NULL;
+	const char *store = get_kwest_options()->store;
+	char *homedir = NULL;
+	char *abspath, *sep;
+	int len;
+
+	abspath = malloc(PATH_MAX);
+	if (abspath == NULL) {
+		return NULL;
+	}
+	if (store != NULL) {
+		len = snprintf(abspath, PATH_MAX, "%s%s", store, path);
+	} else {
+		get_homedir(&homedir);
+		len = snprintf(abspath, PATH_MAX, "%s%s%s%s", homedir,
+		               CONFIG_LOCATION, STORE_DIR, path);
+	}
+	if (len >= PATH_MAX) {
+		free(abspath);
+		return NULL;
+	}
+
+	/* directories of store and of tags in path */
+	for (sep = strchr(abspath + 1, '/'); sep != NULL;
+	     sep = strchr(sep + 1, '/')) {
+		*sep = '\0';
+		if (mkdir(abspath, KW_STDIR) == -1 && errno != EEXIST) {
+			log_msg("get_newfile_path: cannot make %s", abspath);
+			free(abspath);
+			return NULL;
+		}
+		*sep = '/';
+	}
+	return abspath;
+}
+
+/**
+ * @brief create a new file on disk and add it to kwest under parent tag
+ * @param path
+ * @param mode mode of file on disk
+ * @param flags flags file on disk is opened with
+ * @return descriptor of file on disk on SUCCESS
+ * @return -EEXIST if a file of the same name is in kwest
+ * @return -errno on error
+ * @note the file is added without metadata, which is extracted once it
+ * has been written, see ingest.c
+ * @see get_newfile_path
+ * @author HP
+ */
+int create_this_file(const char *path, mode_t mode, int flags)
+{
+	char *tmp_path = strdup(path);
+	char *file = strrchr(tmp_path, '/');
+	char *tag = NULL;
+	const char *abspath = NULL;
+	int fd;
+
+	*file++ = '\0';
+	if (get_file_id(file) != KW_FAIL) {
+		free(tmp_path);
+		return -EEXIST;
+	}
+	tag = strrchr(tmp_path, '/');
+	tag = (tag == NULL) ? TAG_ROOT : tag + 1;
+
+	abspath = get_newfile_path(path);
+	if (abspath == NULL) {
+		free(tmp_path);
+		return -EIO;
+	}
+
+	/* files on disk that are not in kwest are never overwritten */
+	fd = open(abspath, (flags & ~O_TRUNC) | O_CREAT | O_EXCL, mode);
+	if (fd == -1) {
+		fd = -errno;
+	} else if (add_new_file(abspath) != KW_SUCCESS ||
+	           tag_file(tag, file) != KW_SUCCESS) {
+		log_msg("create_this_file: cannot add %s", abspath);
+		close(fd);
+		remove_file(abspath);
+		unlink(abspath);
+		fd = -EIO;
+	}
+
+	free((char *)abspath);
+	free(tmp_path);
+	return fd;
 }
 
 /**
@@ -359,6 +574,7 @@ int rename_this_file(const char *_from, const char *_to, int mode)
 	char *file2 = strrchr(to,   '/');
 	char *tag1 = NULL;
 	char *tag2 = NULL;
+	char *save1 = NULL, *save2 = NULL;
 	int ret = KW_SUCCESS;
 	if (strcmp(file1, file2) == 0) {
 		log_msg("%s mv OK",file1);
@@ -372,7 +588,8 @@ int rename_this_file(const char *_from, const char *_to, int mode)
 	 * e.g. within audio, within image, within files etc.
 	 * moving between say audio and image should be RESTRICTED
 	 */
-	if (strcmp(strtok(from, "/"), strtok(to, "/")) != 0) {
+	if (strcmp(strtok_r(from, "/", &save1),
+	           strtok_r(to, "/", &save2)) != 0) {
 		if (strstr(_to, "/harsh") != _to) {
 			log_msg("DOMAIN of mv not same");
 			return -EPERM;
@@ -383,12 +600,31 @@ int rename_this_file(const char *_from, const char *_to, int mode)
 	tag1 = strrchr(_from,'/'); tag2 = strrchr(_to,'/');
 	*tag1 = '\0'; *tag2 = '\0';
 	tag1 = strrchr(_from,'/')+1; tag2 = strrchr(_to,'/')+1;
-	log_msg("tag %s in %s",file1, tag2);
+
+	ret = retag_file(tag1, tag2, file1, mode);
+	free(from); free(to); free(file1);
+	return ret;
+}
+
+/**
+ * @brief move or copy file from one tag to another
+ * @param tag1 - tag the file is moved from
+ * @param tag2 - tag the file is moved or copied to
+ * @param file - file name
+ * @param mode - DBFUSE_MV or DBFUSE_CP
+ * @return KW_SUCCESS: SUCCESS, KW_ERROR: ERROR
+ * @author HP
+ */
+int retag_file(const char *tag1, const char *tag2, const char *file, int mode)
+{
+	int ret = KW_SUCCESS;
+	log_msg("tag %s in %s",file, tag2);
 	
 	if (mode == DBFUSE_MV) {
-		log_msg("untag %s from %s", file1, tag1);
-		if (untag_file(tag1, file1) == KW_SUCCESS) {
-			if (tag_file(tag2, file1) == KW_SUCCESS) {
+		log_msg("untag %s from %s", file, tag1);
+		if (untag_file(tag1, file) == KW_SUCCESS) {
+			pathcache_invalidate_entry(tag1, file);
+			if (tag_file(tag2, file) == KW_SUCCESS) {
 				log_msg("tag operation successfull");
 			} else {
 				log_msg("tag operation failed");
@@ -400,7 +636,7 @@ int rename_this_file(const char *_from, const char *_to, int mode)
 			ret = KW_ERROR;
 		}
 	} else if (mode == DBFUSE_CP) {
-		if (tag_file(tag2, file1) == KW_SUCCESS) {
+		if (tag_file(tag2, file) == KW_SUCCESS) {
 			log_msg("tag operation successfull");
 		} else {
 			log_msg("tag operation failed");
@@ -408,7 +644,35 @@ int rename_this_file(const char *_from, const char *_to, int mode)
 		}
 		log_msg("cp operation successfull");
 	}
-	free(from); free(to); free(file1);
+	return ret;
+}
+
+/**
+ * @brief tag file of the same name under parent tag of path
+ * @details a copy within kwest is the same file tagged once more, the
+ * backing file is shared with the original
+ * @param path - path of the copy
+ * @return KW_SUCCESS: SUCCESS, -EPERM: file not in kwest, KW_ERROR: ERROR
+ * @author HP
+ */
+int copy_this_file(const char *_path)
+{
+	char *path = strdup(_path);
+	char *file = strrchr(path, '/');
+	char *tag = NULL;
+	int ret;
+
+	*file++ = '\0';
+	if (get_file_id(file) == KW_FAIL) {
+		log_msg("%s not in kwest", file);
+		free(path);
+		return -EPERM;
+	}
+	tag = strrchr(path, '/');
+	tag = (tag == NULL) ? TAG_ROOT : tag + 1;
+
+	ret = retag_file(tag, tag, file, DBFUSE_CP);
+	free(path);
 	return ret;
 }
 
@@ -440,6 +704,7 @@ int remove_this_file(const char *path)
 	
 	if (untag_file(tagname, filename) == KW_SUCCESS) {
 		log_msg("remove_this_file: untag file successful");
+		pathcache_invalidate_entry(tagname, filename);
 		free(tagname);
 		return KW_SUCCESS;
 	}
@@ -470,6 +735,7 @@ int make_directory(const char *path, mode_t mode)
 		log_msg ("make_directory: failed to add tag %s",newtag);
 		return KW_FAIL;
 	}
+	pathcache_invalidate_name(newtag);
 	
 	tptr = newtag -2;
 	while (*tptr != '/') tptr--;
@@ -503,8 +769,122 @@ int remove_directory(const char *path)
 	log_msg ("remove_directory: %s",path);
 	
 	if (remove_tag(get_entry_name(path)) == KW_SUCCESS) {
+		pathcache_invalidate_name(get_entry_name(path));
 		return KW_SUCCESS;
 	}
 	
 	return KW_FAIL;
 }
+
+/**
+ * @brief get tags of file as value of its tags extended attribute
+ * @param fno file id
+ * @param value buffer to hold value, not terminated
+ * @param size size of buffer, 0 to get size of value only
+ * @return size of value on SUCCESS
+ * @return -ERANGE if value does not fit in buffer
+ * @return -EIO on error
+ * @author HP
+ */
+int get_tags_xattr(int fno, char *value, size_t size)
+{
+	char *tags = get_file_tags(fno);
+	int len;
+
+	if (tags == NULL) {
+		return -EIO;
+	}
+	len = strlen(tags);
+	if (size > 0) {
+		if ((size_t)len > size) {
+			len = -ERANGE;
+		} else {
+			memcpy(value, tags, len);
+		}
+	}
+	free(tags);
+	return len;
+}
+
+/**
+ * @brief replace tags of file by value of its tags extended attribute
+ * @param fno file id
+ * @param value comma separated tag names, not terminated
+ * @param size size of value
+ * @return 0 on SUCCESS
+ * @return -EINVAL if a tag does not exist or no tag is given
+ * @return -EIO on error
+ * @author HP
+ */
+int set_tags_xattr(int fno, const char *value, size_t size)
+{
+	char *tags = strndup(value, size);
+	const char *fname = NULL;
+	int res;
+
+	if (tags == NULL) {
+		return -ENOMEM;
+	}
+	res = set_file_tags(fno, tags);
+	free(tags);
+	if (res == KW_ERROR) {
+		return -EINVAL;
+	} else if (res != KW_SUCCESS) {
+		return -EIO;
+	}
+
+	fname = get_file_name(fno);
+	if (fname != NULL) {
+		pathcache_invalidate_name(fname);
+		free((char *)fname);
+	}
+	return 0;
+}
+
+/**
+ * @brief get statistics of filesystem from counts of catalog
+ * @details files and tags are the inodes in use, and the files on disk the
+ * blocks in use. Free blocks and inodes are those of the disk new files
+ * are created on, the store directory, or the directory of the database
+ * when the store is not made yet.
+ * @param st filled with statistics
+ * @return void
+ * @author HP
+ */
+void get_statfs(struct statvfs *st)
+{
+	const char *store = get_kwest_options()->store;
+	struct catalog_counts counts;
+	struct statvfs disk;
+	char dir[PATH_MAX];
+	char *homedir = NULL;
+
+	get_catalog_counts(&counts);
+	memset(st, 0, sizeof(*st));
+	st->f_bsize = KW_STATFS_BSIZE;
+	st->f_frsize = KW_STATFS_BSIZE;
+	if (counts.bytes > 0) { /* never below 0, whatever went uncounted */
+		st->f_blocks = (counts.bytes + KW_STATFS_BSIZE - 1) /
+		               KW_STATFS_BSIZE;
+	}
+	st->f_files = counts.files + counts.tags;
+	st->f_namemax = NAME_MAX;
+
+	if (store == NULL || statvfs(store, &disk) == -1) {
+		get_homedir(&homedir);
+		snprintf(dir, PATH_MAX, "%s%s", homedir, CONFIG_LOCATION);
+		if (statvfs(dir, &disk) == -1) {
+			memset(&disk, 0, sizeof(disk));
+		}
+	}
+	st->f_bfree = disk.f_bfree * disk.f_frsize / KW_STATFS_BSIZE;
+	st->f_bavail = disk.f_bavail * disk.f_frsize / KW_STATFS_BSIZE;
+	st->f_blocks += st->f_bfree; /* df takes used as blocks - free */
+	if (disk.f_ffree == 0) { /* as on btrfs, inodes made as needed */
+		disk.f_ffree = KW_STATFS_FFREE;
+		disk.f_favail = KW_STATFS_FFREE;
+	}
+	st->f_ffree = disk.f_ffree;
+	st->f_favail = disk.f_favail;
+	st->f_files += st->f_ffree;
+}
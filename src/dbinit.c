@@ -27,11 +27,13 @@
 #include <pwd.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/stat.h>
 
 #include "dbinit.h"
 #include "dbbasic.h"
 #include "logging.h"
+#include "stats.h"
 #include "flags.h"
 #include "magicstrings.h"
 
@@ -50,36 +52,98 @@ void get_homedir(char **homedir)
 	*homedir = pw->pw_dir;
 }
 
+static pthread_key_t kwdb_key; /* connection of each thread */
+static pthread_once_t kwdb_once = PTHREAD_ONCE_INIT;
+static char kwdb_dir[QUERY_SIZE]; /* directory holding database file */
+
+/**
+ * @brief Close connection of exiting thread
+ * @param db connection held by thread
+ * @return void
+ * @author SG
+ */
+static void kwdb_destroy(void *db)
+{
+	sqlite3_close((sqlite3 *)db);
+}
+
+#if SQLITE_VERSION_NUMBER >= 3014000
+/**
+ * @brief Count statement run on connection of this thread
+ * @return 0
+ * @author SG
+ */
+static int kwdb_trace(unsigned type, void *ctx, void *stmt, void *sql)
+{
+	(void)type;
+	(void)ctx;
+	(void)stmt;
+	(void)sql;
+	stats_sql();
+	return 0;
+}
+#endif
+
+/**
+ * @brief Set database directory and key holding per thread connections
+ * @param void
+ * @return void
+ * @author SG
+ */
+static void kwdb_init(void)
+{
+	char *homedir;
+
+	/* Set path for database file to /home/user/.config */
+	get_homedir(&homedir);
+	snprintf(kwdb_dir, QUERY_SIZE, "%s%s", homedir, CONFIG_LOCATION);
+	pthread_key_create(&kwdb_key, kwdb_destroy);
+}
+
 /**
  * @brief Initialize Return sqlite pointer object
+ * @details every thread gets its own connection, opened on first use and
+ * closed when the thread exits, so that fuse worker threads never share
+ * one. Connections use WAL so that readers do not wait on a writer, and
+ * wait KW_DB_BUSY_TIMEOUT on a database locked by another connection.
  * @param void
  * @return sqlite3 pointer : SUCCESS, NULL : FAIL
  * @author SG
  */
 sqlite3 *get_kwdb(void)
 {
-	static sqlite3 *db = NULL;
+	sqlite3 *db;
+
+	pthread_once(&kwdb_once, kwdb_init);
+	db = pthread_getspecific(kwdb_key);
 
 	if(db == NULL){
 		int status;
-		char *homedir;
 		char kwestdir[QUERY_SIZE];
 
-		/* Set path for database file to /home/user/.config */
-		get_homedir(&homedir);
-		strcpy(kwestdir,strcat(homedir,CONFIG_LOCATION));
-
-		if(mkdir(kwestdir, KW_STDIR) == -1 && errno != EEXIST) {
+		if(mkdir(kwdb_dir, KW_STDIR) == -1 && errno != EEXIST) {
 			return NULL;
 		}
 
+		strcpy(kwestdir, kwdb_dir);
 		strcat(kwestdir, DATABASE_NAME);
-		status = sqlite3_open(kwestdir,&db);
+		/* connection is used only by this thread */
+		status = sqlite3_open_v2(kwestdir, &db, SQLITE_OPEN_READWRITE |
+		                         SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX,
+		                         NULL);
 
 		if(status != SQLITE_OK) {
 			log_msg("%s",ERR_DB_CONN);
+			sqlite3_close(db);
 			return NULL;
 		}
+
+		sqlite3_busy_timeout(db, KW_DB_BUSY_TIMEOUT);
+		sqlite3_exec(db, "PRAGMA journal_mode=WAL", 0, 0, 0);
+#if SQLITE_VERSION_NUMBER >= 3014000
+		sqlite3_trace_v2(db, SQLITE_TRACE_STMT, kwdb_trace, NULL);
+#endif
+		pthread_setspecific(kwdb_key, db);
 	}
 
 	return db;
@@ -113,6 +177,28 @@ int create_db(void)
 	"(t1 integer,t2 integer,associationid integer);");
 	status = sqlite3_exec(get_kwdb(),query,0,0,0);
 
+	/* Indexes for listing tags in order of id */
+	strcpy(query,"create index if not exists FileAssociationIndex "
+	"on FileAssociation (tno,fno);");
+	status = sqlite3_exec(get_kwdb(),query,0,0,0);
+
+	strcpy(query,"create index if not exists TagAssociationIndex "
+	"on TagAssociation (t2,associationid,t1);");
+	status = sqlite3_exec(get_kwdb(),query,0,0,0);
+
+	/* Uses of files, indexed in order of their virtual tags */
+	strcpy(query,"create table if not exists FileUsage "
+	"(fno integer primary key,opens integer,last integer);");
+	status = sqlite3_exec(get_kwdb(),query,0,0,0);
+
+	strcpy(query,"create index if not exists FileUsageLastIndex "
+	"on FileUsage (last);");
+	status = sqlite3_exec(get_kwdb(),query,0,0,0);
+
+	strcpy(query,"create index if not exists FileUsageOpensIndex "
+	"on FileUsage (opens,last);");
+	status = sqlite3_exec(get_kwdb(),query,0,0,0);
+
 	strcpy(query,"create table if not exists MetaInfo "
 	"(filetype text,tag text);");
 	status = sqlite3_exec(get_kwdb(),query,0,0,0);
@@ -146,6 +232,8 @@ int create_db(void)
 
 /**
  * @brief Close Kwest Database Connection
+ * @details closes the connection of the calling thread, connections of
+ * other threads are closed as they exit
  * @param void
  * @return KW_SUCCESS : SUCCESS
  * @author SG
@@ -159,6 +247,7 @@ int close_db(void)
 	if (status != SQLITE_OK) {
 		log_msg("%s", ERR_DB_CLOSE);
 	} else {
+		pthread_setspecific(kwdb_key, NULL);
 		log_msg("%s", SUC_DB_CLOSE);
 	}
 
@@ -186,3 +275,14 @@ int commit_transaction(void)
 {
 	return (int)sqlite3_exec(get_kwdb(),"COMMIT",0,0,0);
 }
+
+/**
+ * @brief Rollback transaction
+ * @param void
+ * @return KW_SUCCESS : SUCCESS
+ * @author HP
+ */
+int rollback_transaction(void)
+{
+	return (int)sqlite3_exec(get_kwdb(),"ROLLBACK",0,0,0);
+}
@@ -0,0 +1,377 @@
+/**
+ * @file dbquery.c
+ * @brief boolean queries over tags given as paths
+ * @details a query path is made of components each starting with an
+ * operator followed by names of tags separated by commas:
+ @code
+	/+Rock,Jazz		files tagged Rock or Jazz
+	/+Rock/+2012		files tagged Rock and 2012
+	/+Rock/+2012/-Live	as above, leaving out those tagged Live
+ @endcode
+ * Files of a query are found by a single statement, driven by the clause
+ * having fewest files and filtered by the others, so that its cost
+ * follows the smallest tag of the query and not the largest.
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sqlite3.h>
+
+#include "dbquery.h"
+#include "dbinit.h"
+#include "dbkey.h"
+#include "logging.h"
+#include "flags.h"
+#include "magicstrings.h"
+
+/* Most files counted under a tag while planning */
+#define PLAN_FILES_MAX 1024
+
+/* --------------------------- LOCAL FUNCTIONS ------------------------------ */
+
+/**
+ * @brief Return number of files associated to tag, up to PLAN_FILES_MAX
+ * @param tno - tag id
+ * @return number of files
+ * @note counted from the FileAssociation index, stopping at the cap so
+ * that planning costs the same for a tag of a thousand files as for one
+ * of a million
+ * @author HP
+ */
+static long long tag_files(int tno)
+{
+	sqlite3_stmt *stmt;
+	char query[QUERY_SIZE];
+	long long files = 0;
+
+	sprintf(query,"select count(*) from (select 1 from FileAssociation "
+	              "where tno = %d limit %d);", tno, PLAN_FILES_MAX);
+	sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+
+	if(sqlite3_step(stmt) == SQLITE_ROW) {
+		files = sqlite3_column_int64(stmt,0);
+	}
+
+	sqlite3_finalize(stmt);
+	return files;
+}
+
+/**
+ * @brief Order of evaluation of clauses
+ * @details clauses taking files in are evaluated first, fewest files
+ * first, as the first one drives the query and each following one can
+ * only narrow it. Clauses leaving files out follow, most files first, as
+ * they are the likeliest to reject a file early.
+ * @author HP
+ */
+static int clause_order(const void *a, const void *b)
+{
+	const struct kw_clause *c1 = a;
+	const struct kw_clause *c2 = b;
+
+	if(c1->op != c2->op) {
+		return (c1->op == KW_QUERY_AND) ? -1 : 1;
+	}
+	if(c1->files == c2->files) {
+		return 0;
+	}
+	if(c1->op == KW_QUERY_AND) {
+		return (c1->files < c2->files) ? -1 : 1;
+	}
+	return (c1->files > c2->files) ? -1 : 1;
+}
+
+/**
+ * @brief Order clauses of query by number of files under their tags
+ * @param q - query
+ * @return void
+ * @note the files of a union are taken as the sum over its tags, which is
+ * the most it can have. Tags past PLAN_FILES_MAX count as equal, the
+ * smallest tag is still found when it is below the cap.
+ * @author HP
+ */
+static void query_plan(struct kw_query *q)
+{
+	struct kw_clause *c;
+	int i, j;
+
+	for(i = 0; i < q->nclauses; i++) {
+		c = &q->clauses[i];
+		c->files = 0;
+		for(j = 0; j < c->ntags; j++) {
+			c->files += tag_files(c->tnos[j]);
+		}
+	}
+	qsort(q->clauses, q->nclauses, sizeof(struct kw_clause),
+	      clause_order);
+	q->planned = true;
+}
+
+/**
+ * @brief Return comma separated ids of tags in clause
+ * @param c - clause
+ * @return ids to be freed by sqlite3_free : SUCCESS, NULL : FAIL
+ * @author HP
+ */
+static char *clause_tags(const struct kw_clause *c)
+{
+	char *tags = NULL;
+	int i;
+
+	for(i = 0; i < c->ntags; i++) {
+		tags = sqlite3_mprintf("%z%s%d", tags, (i == 0) ? "" : ",",
+		                       c->tnos[i]);
+	}
+	return tags;
+}
+
+/**
+ * @brief Return condition on file for clause
+ * @param c - clause
+ * @param key - column holding file id
+ * @return condition to be freed by sqlite3_free : SUCCESS, NULL : FAIL
+ * @note a single seek of the FileAssociation index for each tag
+ * @author HP
+ */
+static char *clause_sql(const struct kw_clause *c, const char *key)
+{
+	return sqlite3_mprintf(" and %sexists (select 1 from FileAssociation "
+	                       "where tno in (%z) and fno = %s)",
+	                       (c->op == KW_QUERY_NOT) ? "not " : "",
+	                       clause_tags(c), key);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Check if name of path component is a query
+ * @param name - name of component
+ * @return true if name starts with a query operator
+ * @author HP
+ */
+bool is_query_component(const char *name)
+{
+	return (*name == KW_QUERY_AND || *name == KW_QUERY_NOT) &&
+	       *(name + 1) != '\0';
+}
+
+/**
+ * @brief Check if path is a query, starting with a query component
+ * @param path - path of file system
+ * @return true if path is a query
+ * @note tags whose names start with a query operator are not reachable
+ * from root
+ * @author HP
+ */
+bool is_query_path(const char *path)
+{
+	return *path == '/' &&
+	       (*(path + 1) == KW_QUERY_AND || *(path + 1) == KW_QUERY_NOT);
+}
+
+/**
+ * @brief Parse query path into its clauses
+ * @param path - path made only of query components
+ * @return query to be freed by query_free : SUCCESS, NULL : FAIL
+ * @note fails on unknown tags, and on queries without any clause taking
+ * files in, as those would list every file in kwest
+ * @author HP
+ */
+struct kw_query *query_parse(const char *path)
+{
+	struct kw_query *q = NULL;
+	struct kw_clause *c = NULL;
+	char *tmp_path = NULL, *name, *tag;
+	char *save_name, *save_tag;
+	bool has_and = false;
+	int n;
+
+	q = calloc(1, sizeof(struct kw_query));
+	tmp_path = strdup(path);
+	if(q == NULL || tmp_path == NULL) {
+		goto fail;
+	}
+
+	for(name = strtok_r(tmp_path, "/", &save_name); name != NULL;
+	    name = strtok_r(NULL, "/", &save_name)) {
+		if(is_query_component(name) == false) {
+			goto fail;
+		}
+		c = realloc(q->clauses,
+		            (q->nclauses + 1) * sizeof(struct kw_clause));
+		if(c == NULL) {
+			goto fail;
+		}
+		q->clauses = c;
+		c = &q->clauses[q->nclauses++];
+		memset(c, 0, sizeof(struct kw_clause));
+		c->op = *name;
+
+		for(n = 1, tag = name; *tag != '\0'; tag++) {
+			n += (*tag == KW_QUERY_SEP);
+		}
+		c->tnos = malloc(n * sizeof(int));
+		if(c->tnos == NULL) {
+			goto fail;
+		}
+		for(tag = strtok_r(name + 1, ",", &save_tag); tag != NULL;
+		    tag = strtok_r(NULL, ",", &save_tag)) {
+			c->tnos[c->ntags] = get_tag_id(tag);
+			if(c->tnos[c->ntags] == KW_FAIL) {
+				goto fail;
+			}
+			c->ntags++;
+		}
+		if(c->ntags == 0) {
+			goto fail;
+		}
+		has_and |= (c->op == KW_QUERY_AND);
+	}
+
+	if(has_and == false) {
+		goto fail;
+	}
+	free(tmp_path);
+	return q;
+
+fail:
+	free(tmp_path);
+	query_free(q);
+	return NULL;
+}
+
+/**
+ * @brief Free parsed query
+ * @param q - query, may be NULL
+ * @return void
+ * @author HP
+ */
+void query_free(struct kw_query *q)
+{
+	int i;
+
+	if(q == NULL) {
+		return;
+	}
+	for(i = 0; i < q->nclauses; i++) {
+		free(q->clauses[i].tnos);
+	}
+	free(q->clauses);
+	free(q);
+}
+
+/**
+ * @brief Return id, name and absolute path of files satisfying query
+ * @param q - query, planned on first call
+ * @param from - smallest file id returned
+ * @return sqlite3_stmt pointer : SUCCESS, NULL : FAIL
+ * @note rows are in order of file id, so a listing can be resumed from the
+ * id following the last one returned. A driving clause of a single tag
+ * walks the FileAssociation index from that id, as get_files_by_tno does.
+ * @see row_from_stmt
+ * @author HP
+ */
+sqlite3_stmt *query_files(struct kw_query *q, int from)
+{
+	struct kw_clause *driver;
+	sqlite3_stmt *stmt = NULL;
+	const char *key;
+	char *query;
+	int status;
+	int i;
+
+	if(q->planned == false) {
+		query_plan(q);
+	}
+	driver = &q->clauses[0];
+
+	if(driver->ntags == 1) {
+		key = "a.fno";
+		query = sqlite3_mprintf("select f.fno,f.fname,f.abspath from "
+		                        "FileAssociation a join FileDetails f "
+		                        "on f.fno = a.fno where a.tno = %d and "
+		                        "a.fno >= %d",
+		                        driver->tnos[0], from);
+	} else {
+		key = "f.fno";
+		query = sqlite3_mprintf("select f.fno,f.fname,f.abspath from "
+		                        "FileDetails f where f.fno in (select "
+		                        "fno from FileAssociation where tno in "
+		                        "(%z) and fno >= %d)",
+		                        clause_tags(driver), from);
+	}
+	for(i = 1; i < q->nclauses; i++) {
+		query = sqlite3_mprintf("%z%z", query,
+		                        clause_sql(&q->clauses[i], key));
+	}
+	query = sqlite3_mprintf("%z order by %s;", query, key);
+	if(query == NULL) {
+		return NULL;
+	}
+
+	status = sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+	sqlite3_free(query);
+
+	if(status != SQLITE_OK){ /* Error Preparing query */
+		log_msg("query_files : %s",ERR_PREP_QUERY);
+		return NULL;
+	}
+
+	return stmt;
+}
+
+/**
+ * @brief Check if file satisfies query
+ * @param q - query
+ * @param fno - file id
+ * @return true if file satisfies every clause of query
+ * @author HP
+ */
+bool query_matches(struct kw_query *q, int fno)
+{
+	sqlite3_stmt *stmt = NULL;
+	char *query;
+	int status;
+	int i;
+
+	query = sqlite3_mprintf("select 1 from FileDetails f where f.fno = %d",
+	                        fno);
+	for(i = 0; i < q->nclauses; i++) {
+		query = sqlite3_mprintf("%z%z", query,
+		                        clause_sql(&q->clauses[i], "f.fno"));
+	}
+	query = sqlite3_mprintf("%z;", query);
+	if(query == NULL) {
+		return false;
+	}
+
+	status = sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+	sqlite3_free(query);
+
+	if(status != SQLITE_OK){ /* Error Preparing query */
+		log_msg("query_matches : %s",ERR_PREP_QUERY);
+		return false;
+	}
+
+	status = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+	return status == SQLITE_ROW;
+}
@@ -0,0 +1,414 @@
+/**
+ * @file dbusage.c
+ * @brief recently and frequently used files
+ * @details opens and reads are recorded by each thread into a ring of its
+ * own, so recording takes no lock and does not touch the database. A
+ * background thread writes the rings to the FileUsage table every
+ * USAGE_FLUSH seconds, which the virtual tags of root are listed from.
+ * A thread records a read of the file it last recorded at most once a
+ * second, so streaming a file does not fill its ring.
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <sqlite3.h>
+
+#include "dbusage.h"
+#include "dbinit.h"
+#include "logging.h"
+#include "flags.h"
+#include "magicstrings.h"
+
+#define USAGE_RING 256 /* uses a thread holds till written, older are lost */
+
+/* a use is its time, whether it was an open, and the file id */
+#define USAGE_OPEN        ((uint64_t)1 << 32)
+#define USAGE(t, open, fno) (((uint64_t)(t) << 33) | (open) | (uint32_t)(fno))
+#define USAGE_TIME(u)     ((long long)((u) >> 33))
+#define USAGE_FNO(u)      ((int)(uint32_t)(u))
+
+/**
+ * @struct usage_ring
+ * @brief uses recorded by one thread and not yet written
+ */
+struct usage_ring {
+	uint64_t uses[USAGE_RING];
+	uint64_t head;  /* uses recorded, written by its thread only */
+	uint64_t tail;  /* uses written to database, by usage_flush only */
+	uint64_t last;  /* last use recorded, repeats of it are not */
+	int in_use;     /* held by a running thread */
+	struct usage_ring *next;
+};
+
+static const char *usage_names[USAGE_KINDS] = {
+	RECENT_DIR, FREQUENT_DIR
+};
+/* files kept under virtual tag, and their order */
+static const char *usage_where[USAGE_KINDS] = {
+	"", " where u.opens > 0"
+};
+static const char *usage_order[USAGE_KINDS] = {
+	"u.last desc", "u.opens desc, u.last desc"
+};
+
+static struct usage_ring *usage_rings = NULL; /* never freed */
+static pthread_key_t usage_key; /* ring of each thread */
+static pthread_once_t usage_once = PTHREAD_ONCE_INIT;
+
+static pthread_mutex_t usage_flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t usage_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t usage_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t usage_thread;
+static bool usage_running = false;
+
+/**
+ * @brief hand ring of exiting thread over to the next new thread
+ * @author HP
+ */
+static void usage_release(void *ring)
+{
+	__atomic_store_n(&((struct usage_ring *)ring)->in_use, 0,
+	                 __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief create key holding ring of each thread
+ * @author HP
+ */
+static void usage_init(void)
+{
+	pthread_key_create(&usage_key, usage_release);
+}
+
+/**
+ * @brief ring of calling thread, taken on first use
+ * @return ring, NULL on memory error
+ * @see stats_self
+ * @author HP
+ */
+static struct usage_ring *usage_self(void)
+{
+	struct usage_ring *r;
+	int unused;
+
+	pthread_once(&usage_once, usage_init);
+	r = pthread_getspecific(usage_key);
+	if (r != NULL) {
+		return r;
+	}
+
+	for (r = __atomic_load_n(&usage_rings, __ATOMIC_ACQUIRE); r != NULL;
+	     r = r->next) {
+		unused = 0;
+		if (__atomic_compare_exchange_n(&r->in_use, &unused, 1, false,
+		                                __ATOMIC_ACQUIRE,
+		                                __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+	if (r == NULL) {
+		r = calloc(1, sizeof(struct usage_ring));
+		if (r == NULL) {
+			return NULL;
+		}
+		r->in_use = 1;
+		r->next = __atomic_load_n(&usage_rings, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&usage_rings, &r->next, r,
+		                                    false, __ATOMIC_RELEASE,
+		                                    __ATOMIC_RELAXED));
+	}
+	pthread_setspecific(usage_key, r);
+	return r;
+}
+
+/**
+ * @brief record use of file into ring of this thread
+ * @param fno file id
+ * @param open USAGE_OPEN for an open, 0 for a read
+ * @return void
+ * @author HP
+ */
+static void usage_record(int fno, uint64_t open)
+{
+	struct usage_ring *r;
+	uint64_t use;
+
+	if (fno < 0 || (r = usage_self()) == NULL) {
+		return;
+	}
+	use = USAGE(time(NULL), open, fno);
+	if (use == r->last) {
+		return;
+	}
+	r->last = use;
+	__atomic_store_n(&r->uses[r->head % USAGE_RING], use,
+	                 __ATOMIC_RELAXED);
+	__atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief record open of file by this thread
+ * @param fno file id
+ * @return void
+ * @author HP
+ */
+void usage_open(int fno)
+{
+	usage_record(fno, USAGE_OPEN);
+}
+
+/**
+ * @brief record read of file by this thread
+ * @param fno file id
+ * @return void
+ * @author HP
+ */
+void usage_read(int fno)
+{
+	usage_record(fno, 0);
+}
+
+/**
+ * @brief write use to database
+ * @param add statement adding row of file
+ * @param update statement counting use of file
+ * @param use use recorded
+ * @return void
+ * @author HP
+ */
+static void usage_write(sqlite3_stmt *add, sqlite3_stmt *update,
+                        uint64_t use)
+{
+	sqlite3_bind_int(add, 1, USAGE_FNO(use));
+	sqlite3_step(add);
+	sqlite3_reset(add);
+
+	sqlite3_bind_int(update, 1, (use & USAGE_OPEN) ? 1 : 0);
+	sqlite3_bind_int64(update, 2, USAGE_TIME(use));
+	sqlite3_bind_int(update, 3, USAGE_FNO(use));
+	sqlite3_step(update);
+	sqlite3_reset(update);
+}
+
+/**
+ * @brief write uses recorded till now to database
+ * @details rings are read without stopping the threads recording into
+ * them. A use overwritten while being read is dropped, as are uses older
+ * than the last USAGE_RING of a thread.
+ * @param void
+ * @return void
+ * @author HP
+ */
+void usage_flush(void)
+{
+	sqlite3_stmt *add = NULL, *update = NULL;
+	struct usage_ring *r;
+	uint64_t head, i, use;
+
+	pthread_mutex_lock(&usage_flush_lock);
+	/* rows only for files in kwest, as uses may outlive their files */
+	sqlite3_prepare_v2(get_kwdb(),"insert or ignore into FileUsage "
+	                   "select fno,0,0 from FileDetails where fno = ?;",
+	                   -1,&add,0);
+	sqlite3_prepare_v2(get_kwdb(),"update FileUsage set opens = opens + ?,"
+	                   " last = max(last, ?) where fno = ?;",-1,&update,0);
+	if (add == NULL || update == NULL) {
+		log_msg("usage_flush : %s",ERR_PREP_QUERY);
+		goto out;
+	}
+
+	begin_transaction();
+	for (r = __atomic_load_n(&usage_rings, __ATOMIC_ACQUIRE); r != NULL;
+	     r = r->next) {
+		head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		i = (head - r->tail > USAGE_RING) ? head - USAGE_RING : r->tail;
+		for (; i < head; i++) {
+			use = __atomic_load_n(&r->uses[i % USAGE_RING],
+			                      __ATOMIC_RELAXED);
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&r->head, __ATOMIC_RELAXED) - i >=
+			    USAGE_RING) {
+				continue;
+			}
+			usage_write(add, update, use);
+		}
+		r->tail = head;
+	}
+	if (commit_transaction() != SQLITE_OK) {
+		log_msg("usage_flush : could not commit");
+		rollback_transaction();
+	}
+
+out:
+	sqlite3_finalize(add);
+	sqlite3_finalize(update);
+	pthread_mutex_unlock(&usage_flush_lock);
+}
+
+/**
+ * @brief write recorded uses every USAGE_FLUSH seconds till stopped
+ * @param arg unused
+ * @return NULL
+ * @author HP
+ */
+static void *usage_loop(void *arg)
+{
+	struct timespec ts;
+	(void)arg;
+
+	pthread_mutex_lock(&usage_lock);
+	while (usage_running) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += USAGE_FLUSH;
+		pthread_cond_timedwait(&usage_cond, &usage_lock, &ts);
+		pthread_mutex_unlock(&usage_lock);
+		usage_flush();
+		pthread_mutex_lock(&usage_lock);
+	}
+	pthread_mutex_unlock(&usage_lock);
+	return NULL;
+}
+
+/**
+ * @brief start writing recorded uses to database in the background
+ * @param void
+ * @return KW_SUCCESS: SUCCESS, KW_FAIL: FAIL
+ * @note uses are still recorded if this fails, and written when the
+ * virtual tags are listed
+ * @author HP
+ */
+int usage_start(void)
+{
+	usage_running = true;
+	if (pthread_create(&usage_thread, NULL, usage_loop, NULL) != 0) {
+		usage_running = false;
+		return KW_FAIL;
+	}
+	return KW_SUCCESS;
+}
+
+/**
+ * @brief stop writing uses in the background, after writing those recorded
+ * @param void
+ * @return void
+ * @author HP
+ */
+void usage_stop(void)
+{
+	if (!usage_running) {
+		return;
+	}
+	pthread_mutex_lock(&usage_lock);
+	usage_running = false;
+	pthread_cond_signal(&usage_cond);
+	pthread_mutex_unlock(&usage_lock);
+	pthread_join(usage_thread, NULL);
+}
+
+/**
+ * @brief virtual tag holding path
+ * @param path path of file system
+ * @return USAGE_RECENT or USAGE_FREQUENT, KW_FAIL if path is not under one
+ * @author HP
+ */
+int usage_of_path(const char *path)
+{
+	size_t len;
+	int kind;
+
+	for (kind = 0; kind < USAGE_KINDS; kind++) {
+		len = strlen(usage_names[kind]);
+		if (*path == '/' &&
+		    strncmp(path + 1, usage_names[kind], len) == 0 &&
+		    (*(path + 1 + len) == '\0' || *(path + 1 + len) == '/')) {
+			return kind;
+		}
+	}
+	return KW_FAIL;
+}
+
+/**
+ * @brief name of virtual tag
+ * @param kind USAGE_RECENT or USAGE_FREQUENT
+ * @return name
+ * @author HP
+ */
+const char *usage_name(int kind)
+{
+	return usage_names[kind];
+}
+
+/**
+ * @brief Return id, name and absolute path of files under virtual tag
+ * @param kind - USAGE_RECENT or USAGE_FREQUENT
+ * @param from - number of files already returned
+ * @return sqlite3_stmt pointer : SUCCESS, NULL : FAIL
+ * @note at most USAGE_LIST files, read from the index of their order
+ * @see row_from_stmt
+ * @author HP
+ */
+sqlite3_stmt *usage_files(int kind, int from)
+{
+	sqlite3_stmt *stmt;
+	char query[QUERY_SIZE];
+	int status;
+
+	sprintf(query,"select f.fno,f.fname,f.abspath from FileUsage u join "
+	              "FileDetails f on f.fno = u.fno%s order by %s "
+	              "limit %d offset %d;", usage_where[kind],
+	              usage_order[kind],
+	              (from < USAGE_LIST) ? USAGE_LIST - from : 0, from);
+	status = sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+
+	if (status != SQLITE_OK) { /* Error Preparing query */
+		log_msg("usage_files : %s",ERR_PREP_QUERY);
+		return NULL;
+	}
+
+	return stmt;
+}
+
+/**
+ * @brief Check if file is under virtual tag
+ * @param kind - USAGE_RECENT or USAGE_FREQUENT
+ * @param fno - file id
+ * @return true if file is one of those listed under virtual tag
+ * @author HP
+ */
+bool usage_has_file(int kind, int fno)
+{
+	sqlite3_stmt *stmt;
+	char query[QUERY_SIZE];
+	int status;
+
+	sprintf(query,"select 1 from (select u.fno from FileUsage u join "
+	              "FileDetails f on f.fno = u.fno%s order by %s "
+	              "limit %d) where fno = %d;", usage_where[kind],
+	              usage_order[kind], USAGE_LIST, fno);
+	sqlite3_prepare_v2(get_kwdb(),query,-1,&stmt,0);
+
+	status = sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+	return status == SQLITE_ROW;
+}
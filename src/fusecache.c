@@ -0,0 +1,621 @@
+/**
+ * @file fusecache.c
+ * @brief in-memory caches used by the fuse layer
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "fusecache.h"
+#include "fuseopts.h"
+#include "stats.h"
+#include "logging.h"
+#include "flags.h"
+
+#define PATHCACHE_BUCKETS 4096  /* number of hash chains */
+#define PATHCACHE_MAX     65536 /* entries held before cache is flushed */
+#define STATCACHE_BUCKETS 4096  /* number of hash chains */
+#define STATCACHE_MAX     65536 /* entries held before cache is flushed */
+#define SUGGESTCACHE_BUCKETS 1024 /* number of hash chains */
+#define SUGGESTCACHE_MAX     4096 /* entries held before cache is flushed */
+
+/**
+ * @struct pathcache_entry
+ * @brief virtual path resolved to a tag or a file
+ */
+struct pathcache_entry {
+	char *path;    /* virtual path in kwest */
+	int kind;      /* KW_PATH_TAG or KW_PATH_FILE */
+	int id;        /* tno for tags, fno for files */
+	char *abspath; /* absolute path on disk for files, NULL for tags */
+	struct pathcache_entry *next;
+};
+
+static struct pathcache_entry *pathcache[PATHCACHE_BUCKETS];
+static int pathcache_count = 0;
+static pthread_mutex_t pathcache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief hash virtual path into a bucket
+ * @param path
+ * @return bucket index
+ * @author HP
+ */
+static unsigned int pathcache_hash(const char *path)
+{
+	unsigned int hash = 5381;
+
+	while(*path != '\0') {
+		hash = ((hash << 5) + hash) + (unsigned char)*path++;
+	}
+
+	return hash % PATHCACHE_BUCKETS;
+}
+
+/**
+ * @brief free a cache entry
+ * @param entry
+ * @return void
+ * @author HP
+ */
+static void pathcache_free_entry(struct pathcache_entry *entry)
+{
+	free(entry->path);
+	free(entry->abspath);
+	free(entry);
+}
+
+/**
+ * @brief drop all entries, lock must be held
+ * @param void
+ * @return void
+ * @author HP
+ */
+static void pathcache_clear(void)
+{
+	struct pathcache_entry *entry, *next;
+	int i;
+
+	for(i = 0; i < PATHCACHE_BUCKETS; i++) {
+		for(entry = pathcache[i]; entry != NULL; entry = next) {
+			next = entry->next;
+			pathcache_free_entry(entry);
+		}
+		pathcache[i] = NULL;
+	}
+	pathcache_count = 0;
+}
+
+/**
+ * @brief drop entries matching given predicate, lock must be held
+ * @param match predicate deciding whether path is to be dropped
+ * @param arg1 first argument passed to predicate
+ * @param arg2 second argument passed to predicate
+ * @return void
+ * @author HP
+ */
+static void pathcache_drop_if(bool (*match)(const char *path, const char *arg1,
+                                            const char *arg2),
+                              const char *arg1, const char *arg2)
+{
+	struct pathcache_entry **link, *entry;
+	int i;
+
+	for(i = 0; i < PATHCACHE_BUCKETS; i++) {
+		link = &pathcache[i];
+		while((entry = *link) != NULL) {
+			if((*match)(entry->path, arg1, arg2) == true) {
+				*link = entry->next;
+				pathcache_free_entry(entry);
+				pathcache_count--;
+			} else {
+				link = &entry->next;
+			}
+		}
+	}
+}
+
+/**
+ * @brief check whether name is a component of path
+ * @param path
+ * @param name
+ * @param unused
+ * @return true if path contains /name/ or ends in /name
+ * @author HP
+ */
+static bool path_has_component(const char *path, const char *name,
+                               const char *unused)
+{
+	size_t len = strlen(name);
+	(void)unused;
+
+	while((path = strchr(path, '/')) != NULL) {
+		path++;
+		if(strncmp(path, name, len) == 0 &&
+		   (path[len] == '/' || path[len] == '\0')) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief check whether path ends in /tagname/filename
+ * @param path
+ * @param tagname
+ * @param filename
+ * @return true on match else false
+ * @author HP
+ */
+static bool path_ends_with(const char *path, const char *tagname,
+                           const char *filename)
+{
+	size_t plen = strlen(path);
+	size_t tlen = strlen(tagname);
+	size_t flen = strlen(filename);
+	const char *tail;
+
+	if(plen < tlen + flen + 2) {
+		return false;
+	}
+	tail = path + plen - (tlen + flen + 2);
+
+	return (tail[0] == '/' && strncmp(tail + 1, tagname, tlen) == 0 &&
+	        tail[tlen + 1] == '/' && strcmp(tail + tlen + 2, filename) == 0);
+}
+
+/**
+ * @brief lookup resolved virtual path in cache
+ * @param path virtual path
+ * @param id set to tno/fno of entry, may be NULL
+ * @param abspath set to copy of absolute path for files, may be NULL
+ * @return KW_PATH_TAG, KW_PATH_FILE on hit, KW_PATH_NONE on miss
+ * @note copy returned through abspath must be freed by caller
+ * @author HP
+ */
+int pathcache_lookup(const char *path, int *id, char **abspath)
+{
+	struct pathcache_entry *entry;
+	int kind = KW_PATH_NONE;
+
+	pthread_mutex_lock(&pathcache_lock);
+	for(entry = pathcache[pathcache_hash(path)]; entry != NULL;
+	    entry = entry->next) {
+		if(strcmp(entry->path, path) == 0) {
+			kind = entry->kind;
+			if(id != NULL) {
+				*id = entry->id;
+			}
+			if(abspath != NULL) {
+				*abspath = (entry->abspath == NULL) ?
+				           NULL : strdup(entry->abspath);
+			}
+			break;
+		}
+	}
+	pthread_mutex_unlock(&pathcache_lock);
+
+	stats_count((kind == KW_PATH_NONE) ? STATS_PATHCACHE_MISS :
+	                                     STATS_PATHCACHE_HIT);
+	return kind;
+}
+
+/**
+ * @brief add resolved virtual path to cache
+ * @param path virtual path
+ * @param kind KW_PATH_TAG or KW_PATH_FILE
+ * @param id tno for tags, fno for files
+ * @param abspath absolute path on disk for files, NULL for tags
+ * @return void
+ * @author HP
+ */
+void pathcache_insert(const char *path, int kind, int id, const char *abspath)
+{
+	struct pathcache_entry *entry;
+	unsigned int bucket = pathcache_hash(path);
+
+	pthread_mutex_lock(&pathcache_lock);
+	for(entry = pathcache[bucket]; entry != NULL; entry = entry->next) {
+		if(strcmp(entry->path, path) == 0) { /* already cached */
+			pthread_mutex_unlock(&pathcache_lock);
+			return;
+		}
+	}
+
+	if(pathcache_count >= PATHCACHE_MAX) {
+		log_msg("pathcache: limit reached, flushing");
+		pathcache_clear();
+	}
+
+	entry = malloc(sizeof(struct pathcache_entry));
+	if(entry != NULL) {
+		entry->path = strdup(path);
+		entry->kind = kind;
+		entry->id = id;
+		entry->abspath = (abspath == NULL) ? NULL : strdup(abspath);
+		entry->next = pathcache[bucket];
+		pathcache[bucket] = entry;
+		pathcache_count++;
+	}
+	pthread_mutex_unlock(&pathcache_lock);
+}
+
+/**
+ * @brief drop every cached path having name as one of its components
+ * @details used when a tag is created or removed, since that changes what
+ * every path going through the name resolves to
+ * @param name tagname or filename
+ * @return void
+ * @author HP
+ */
+void pathcache_invalidate_name(const char *name)
+{
+	pthread_mutex_lock(&pathcache_lock);
+	pathcache_drop_if(path_has_component, name, NULL);
+	pthread_mutex_unlock(&pathcache_lock);
+}
+
+/**
+ * @brief drop every cached path ending in /tagname/filename
+ * @details used when a file is untagged, paths to the same file through
+ * other tags stay valid
+ * @param tagname
+ * @param filename
+ * @return void
+ * @author HP
+ */
+void pathcache_invalidate_entry(const char *tagname, const char *filename)
+{
+	pthread_mutex_lock(&pathcache_lock);
+	pathcache_drop_if(path_ends_with, tagname, filename);
+	pthread_mutex_unlock(&pathcache_lock);
+}
+
+/**
+ * @brief drop all cached paths
+ * @param void
+ * @return void
+ * @author HP
+ */
+void pathcache_flush(void)
+{
+	pthread_mutex_lock(&pathcache_lock);
+	pathcache_clear();
+	pthread_mutex_unlock(&pathcache_lock);
+}
+
+/**
+ * @struct statcache_entry
+ * @brief attributes of backing file of a kwest file
+ * @note st holds backing inode, size and mtime along with rest of stat
+ */
+struct statcache_entry {
+	int fno;        /* file id */
+	struct stat st; /* attributes of backing file */
+	double expires; /* monotonic time after which entry is stale */
+	struct statcache_entry *next;
+};
+
+static struct statcache_entry *statcache[STATCACHE_BUCKETS];
+static int statcache_count = 0;
+static pthread_mutex_t statcache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief seconds on monotonic clock
+ * @param void
+ * @return current time
+ * @author HP
+ */
+static double monotonic_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief drop all entries, lock must be held
+ * @param void
+ * @return void
+ * @author HP
+ */
+static void statcache_clear(void)
+{
+	struct statcache_entry *entry, *next;
+	int i;
+
+	for(i = 0; i < STATCACHE_BUCKETS; i++) {
+		for(entry = statcache[i]; entry != NULL; entry = next) {
+			next = entry->next;
+			free(entry);
+		}
+		statcache[i] = NULL;
+	}
+	statcache_count = 0;
+}
+
+/**
+ * @brief lookup attributes of backing file in cache
+ * @param fno file id
+ * @param stbuf filled with cached attributes on hit
+ * @return KW_SUCCESS on fresh hit, KW_FAIL on miss or stale entry
+ * @author HP
+ */
+int statcache_lookup(int fno, struct stat *stbuf)
+{
+	struct statcache_entry *entry;
+	int ret = KW_FAIL;
+
+	pthread_mutex_lock(&statcache_lock);
+	for(entry = statcache[fno % STATCACHE_BUCKETS]; entry != NULL;
+	    entry = entry->next) {
+		if(entry->fno == fno) {
+			if(entry->expires > monotonic_now()) {
+				*stbuf = entry->st;
+				ret = KW_SUCCESS;
+			}
+			break;
+		}
+	}
+	pthread_mutex_unlock(&statcache_lock);
+
+	stats_count((ret == KW_SUCCESS) ? STATS_STATCACHE_HIT :
+	                                  STATS_STATCACHE_MISS);
+	return ret;
+}
+
+/**
+ * @brief add attributes of backing file to cache
+ * @details entry stays valid for stat_timeout seconds
+ * @param fno file id
+ * @param stbuf attributes from stat of backing file
+ * @return void
+ * @author HP
+ */
+void statcache_insert(int fno, const struct stat *stbuf)
+{
+	struct statcache_entry *entry;
+	unsigned int bucket = fno % STATCACHE_BUCKETS;
+	double expires = monotonic_now() + get_kwest_options()->stat_timeout;
+
+	if(fno < 0 || get_kwest_options()->stat_timeout <= 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&statcache_lock);
+	for(entry = statcache[bucket]; entry != NULL; entry = entry->next) {
+		if(entry->fno == fno) { /* refresh existing entry */
+			entry->st = *stbuf;
+			entry->expires = expires;
+			pthread_mutex_unlock(&statcache_lock);
+			return;
+		}
+	}
+
+	if(statcache_count >= STATCACHE_MAX) {
+		statcache_clear();
+	}
+
+	entry = malloc(sizeof(struct statcache_entry));
+	if(entry != NULL) {
+		entry->fno = fno;
+		entry->st = *stbuf;
+		entry->expires = expires;
+		entry->next = statcache[bucket];
+		statcache[bucket] = entry;
+		statcache_count++;
+	}
+	pthread_mutex_unlock(&statcache_lock);
+}
+
+/**
+ * @brief drop cached attributes of file
+ * @details called when file is modified through kwest
+ * @param fno file id
+ * @return void
+ * @author HP
+ */
+void statcache_invalidate(int fno)
+{
+	struct statcache_entry **link, *entry;
+
+	if(fno < 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&statcache_lock);
+	link = &statcache[fno % STATCACHE_BUCKETS];
+	while((entry = *link) != NULL) {
+		if(entry->fno == fno) {
+			*link = entry->next;
+			free(entry);
+			statcache_count--;
+			break;
+		}
+		link = &entry->next;
+	}
+	pthread_mutex_unlock(&statcache_lock);
+}
+
+/**
+ * @struct suggestcache_entry
+ * @brief suggestions for a tag, mined from association rules
+ */
+struct suggestcache_entry {
+	int tno;                 /* tag id */
+	unsigned int generation; /* catalog generation they were mined at */
+	char *lists[KW_SUGGEST_KINDS]; /* comma separated names, or NULL */
+	struct suggestcache_entry *next;
+};
+
+static struct suggestcache_entry *suggestcache[SUGGESTCACHE_BUCKETS];
+static int suggestcache_count = 0;
+static pthread_mutex_t suggestcache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief copy suggestion lists
+ * @param to filled with copies, NULL where from is NULL
+ * @param from lists to copy
+ * @return KW_SUCCESS on SUCCESS
+ * @return KW_FAIL on memory error, with nothing copied
+ * @author HP
+ */
+static int suggestcache_copy(char **to, char *const *from)
+{
+	int i;
+
+	for(i = 0; i < KW_SUGGEST_KINDS; i++) {
+		to[i] = (from[i] == NULL) ? NULL : strdup(from[i]);
+		if(from[i] != NULL && to[i] == NULL) {
+			while(i-- > 0) {
+				free(to[i]);
+			}
+			return KW_FAIL;
+		}
+	}
+	return KW_SUCCESS;
+}
+
+/**
+ * @brief free a cache entry
+ * @param entry
+ * @return void
+ * @author HP
+ */
+static void suggestcache_free_entry(struct suggestcache_entry *entry)
+{
+	int i;
+
+	for(i = 0; i < KW_SUGGEST_KINDS; i++) {
+		free(entry->lists[i]);
+	}
+	free(entry);
+}
+
+/**
+ * @brief drop all entries, lock must be held
+ * @param void
+ * @return void
+ * @author HP
+ */
+static void suggestcache_clear(void)
+{
+	struct suggestcache_entry *entry, *next;
+	int i;
+
+	for(i = 0; i < SUGGESTCACHE_BUCKETS; i++) {
+		for(entry = suggestcache[i]; entry != NULL; entry = next) {
+			next = entry->next;
+			suggestcache_free_entry(entry);
+		}
+		suggestcache[i] = NULL;
+	}
+	suggestcache_count = 0;
+}
+
+/**
+ * @brief lookup suggestions for tag computed at given catalog generation
+ * @details suggestions mined at an older generation are stale, as the
+ * entries of tag they were mined from may have changed since
+ * @param tno tag id
+ * @param generation current generation of catalog
+ * @param lists filled with copies of suggestions, to be freed by caller
+ * @return KW_SUCCESS if found
+ * @return KW_FAIL if not found or stale
+ * @see get_catalog_generation
+ * @author HP
+ */
+int suggestcache_lookup(int tno, unsigned int generation, char **lists)
+{
+	struct suggestcache_entry *entry;
+	int ret = KW_FAIL;
+
+	pthread_mutex_lock(&suggestcache_lock);
+	for(entry = suggestcache[tno % SUGGESTCACHE_BUCKETS]; entry != NULL;
+	    entry = entry->next) {
+		if(entry->tno == tno) {
+			if(entry->generation == generation) {
+				ret = suggestcache_copy(lists, entry->lists);
+			}
+			break;
+		}
+	}
+	pthread_mutex_unlock(&suggestcache_lock);
+
+	stats_count((ret == KW_SUCCESS) ? STATS_SUGGESTCACHE_HIT :
+	                                  STATS_SUGGESTCACHE_MISS);
+	return ret;
+}
+
+/**
+ * @brief add suggestions for tag computed at given catalog generation
+ * @param tno tag id
+ * @param generation generation of catalog they were computed at
+ * @param lists suggestions, copied into cache
+ * @return void
+ * @author HP
+ */
+void suggestcache_insert(int tno, unsigned int generation, char **lists)
+{
+	struct suggestcache_entry *entry;
+	unsigned int bucket = tno % SUGGESTCACHE_BUCKETS;
+	char *copy[KW_SUGGEST_KINDS];
+	int i;
+
+	if(tno < 0 || suggestcache_copy(copy, lists) != KW_SUCCESS) {
+		return;
+	}
+
+	pthread_mutex_lock(&suggestcache_lock);
+	for(entry = suggestcache[bucket]; entry != NULL; entry = entry->next) {
+		if(entry->tno == tno) { /* refresh existing entry */
+			break;
+		}
+	}
+
+	if(entry == NULL) {
+		if(suggestcache_count >= SUGGESTCACHE_MAX) {
+			suggestcache_clear();
+		}
+		entry = calloc(1, sizeof(struct suggestcache_entry));
+		if(entry == NULL) {
+			pthread_mutex_unlock(&suggestcache_lock);
+			for(i = 0; i < KW_SUGGEST_KINDS; i++) {
+				free(copy[i]);
+			}
+			return;
+		}
+		entry->tno = tno;
+		entry->next = suggestcache[bucket];
+		suggestcache[bucket] = entry;
+		suggestcache_count++;
+	}
+
+	entry->generation = generation;
+	for(i = 0; i < KW_SUGGEST_KINDS; i++) {
+		free(entry->lists[i]);
+		entry->lists[i] = copy[i];
+	}
+	pthread_mutex_unlock(&suggestcache_lock);
+}
@@ -0,0 +1,335 @@
+/**
+ * @file fusectl.c
+ * @brief control file taking batches of catalog commands
+ * @details each line written to the control file is a command, its fields
+ * separated by tabs as names of tags and files may hold spaces:
+ @code
+	tag	<tag>	<file>		tag file
+	untag	<tag>	<file>		remove tag from file
+	mkdir	<tag>	[<parent>]	create tag under parent, root if none
+	associate	<tag>	<parent>	group tag under parent
+	import	<directory>		import directory on disk
+ @endcode
+ * empty lines and lines starting with # are ignored. Commands are run
+ * when the file is flushed on close, all in one transaction: if any of
+ * them fails, none of them is applied. Imports are the exception: they
+ * run the metadata plugins on every file, too long to hold the database
+ * locked against other writers, so they are run first, each on its own,
+ * and stay applied. Files imported can be tagged by the same batch.
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "fusectl.h"
+#include "fusecache.h"
+#include "dbbasic.h"
+#include "dbinit.h"
+#include "import.h"
+#include "logging.h"
+#include "flags.h"
+#include "magicstrings.h"
+
+#define CONTROL_MAX_ARGS 4 /* fields of longest command */
+
+/**
+ * @struct kwest_control
+ * @brief data written to an open control file
+ */
+struct kwest_control {
+	char *buf;    /* commands, one per line */
+	size_t len;   /* bytes held in buf */
+	size_t size;  /* bytes allocated for buf */
+	pthread_mutex_t lock;
+};
+
+/**
+ * @struct control_command
+ * @brief command understood by the control file
+ */
+struct control_command {
+	const char *name;
+	int minargs; /* fields including name */
+	int maxargs;
+	int (*run)(int argc, char **argv);
+};
+
+/* batches are run one at a time, and never conflict with each other */
+static pthread_mutex_t control_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief tag<TAB>tag<TAB>file
+ * @author HP
+ */
+static int control_tag(int argc, char **argv)
+{
+	(void)argc;
+	return tag_file(argv[1], argv[2]);
+}
+
+/**
+ * @brief untag<TAB>tag<TAB>file
+ * @author HP
+ */
+static int control_untag(int argc, char **argv)
+{
+	(void)argc;
+	return untag_file(argv[1], argv[2]);
+}
+
+/**
+ * @brief mkdir<TAB>tag[<TAB>parent], as mkdir in the file system
+ * @author HP
+ */
+static int control_mkdir(int argc, char **argv)
+{
+	if (add_tag(argv[1], USER_MADE_TAG) != KW_SUCCESS) {
+		return KW_FAIL;
+	}
+	return add_association(argv[1], (argc > 2) ? argv[2] : TAG_ROOT,
+	                       ASSOC_SUBGROUP);
+}
+
+/**
+ * @brief associate<TAB>tag<TAB>parent
+ * @author HP
+ */
+static int control_associate(int argc, char **argv)
+{
+	(void)argc;
+	return add_association(argv[1], argv[2], ASSOC_SUBGROUP);
+}
+
+/**
+ * @brief import<TAB>directory, directory being an absolute path
+ * @author HP
+ */
+static int control_import(int argc, char **argv)
+{
+	(void)argc;
+	if (*argv[1] != '/') {
+		return KW_ERROR;
+	}
+	return import(argv[1]);
+}
+
+static const struct control_command control_commands[] = {
+	{ "tag",       3, 3, control_tag },
+	{ "untag",     3, 3, control_untag },
+	{ "mkdir",     2, 3, control_mkdir },
+	{ "associate", 3, 3, control_associate },
+	{ "import",    2, 2, control_import },
+	{ NULL,        0, 0, NULL }
+};
+
+/**
+ * @brief run a single command
+ * @param line command, modified to split its fields
+ * @return 0 on SUCCESS
+ * @return -EINVAL if command is not understood or fails
+ * @author HP
+ */
+static int control_run(char *line)
+{
+	const struct control_command *cmd;
+	char *argv[CONTROL_MAX_ARGS + 1];
+	char *field;
+	int argc = 0;
+
+	line[strcspn(line, "\r")] = '\0';
+	if (*line == '\0' || *line == '#') {
+		return 0;
+	}
+	while ((field = strsep(&line, "\t")) != NULL) {
+		if (argc == CONTROL_MAX_ARGS + 1) {
+			break;
+		}
+		argv[argc++] = field;
+	}
+
+	for (cmd = control_commands; cmd->name != NULL; cmd++) {
+		if (strcmp(cmd->name, argv[0]) != 0) {
+			continue;
+		}
+		if (argc < cmd->minargs || argc > cmd->maxargs) {
+			break;
+		}
+		return (cmd->run(argc, argv) == KW_SUCCESS) ? 0 : -EINVAL;
+	}
+	return -EINVAL;
+}
+
+/**
+ * @brief open control file
+ * @param void
+ * @return control file with no commands, NULL on memory error
+ * @author HP
+ */
+struct kwest_control *control_open(void)
+{
+	struct kwest_control *ctl = calloc(1, sizeof(struct kwest_control));
+
+	if (ctl != NULL) {
+		pthread_mutex_init(&ctl->lock, NULL);
+	}
+	return ctl;
+}
+
+/**
+ * @brief add data written to control file to its commands
+ * @details data is appended whatever its offset, as a log
+ * @param ctl control file
+ * @param buf data written
+ * @param size size of data
+ * @return size on SUCCESS
+ * @return -ENOMEM on memory error
+ * @author HP
+ */
+int control_write(struct kwest_control *ctl, const char *buf, size_t size)
+{
+	char *tmp;
+	size_t want;
+
+	pthread_mutex_lock(&ctl->lock);
+	if (ctl->len + size + 1 > ctl->size) {
+		want = (ctl->size == 0) ? 4096 : ctl->size;
+		while (want < ctl->len + size + 1) {
+			want *= 2;
+		}
+		tmp = realloc(ctl->buf, want);
+		if (tmp == NULL) {
+			pthread_mutex_unlock(&ctl->lock);
+			return -ENOMEM;
+		}
+		ctl->buf = tmp;
+		ctl->size = want;
+	}
+	memcpy(ctl->buf + ctl->len, buf, size);
+	ctl->len += size;
+	pthread_mutex_unlock(&ctl->lock);
+
+	return size;
+}
+
+/**
+ * @brief run import commands of batch, outside of its transaction
+ * @details lines run are turned into comments, to be skipped with them
+ * @param buf commands, one per line
+ * @return 0 on SUCCESS
+ * @return -EINVAL if an import fails, those before it stay applied
+ * @author HP
+ */
+static int control_imports(char *buf)
+{
+	char *line, *next;
+	char sep;
+	size_t len;
+	int lineno = 0;
+	int res;
+
+	for (line = buf; *line != '\0'; line = next) {
+		lineno++;
+		len = strcspn(line, "\n");
+		next = line + len + (line[len] == '\n');
+		if (strncmp(line, "import\t", strlen("import\t")) != 0) {
+			continue;
+		}
+		sep = line[len];
+		line[len] = '\0';
+		res = control_run(line);
+		memset(line, '#', len);
+		line[len] = sep;
+		if (res != 0) {
+			log_msg("control: line %d failed", lineno);
+			return res;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief run commands written to control file in a single transaction
+ * @details commands are dropped once run, whether they succeed or not.
+ * Imports are run before the transaction, see control_imports.
+ * @param ctl control file
+ * @return 0 on SUCCESS
+ * @return -EINVAL if a command is not understood or fails, nothing is
+ * applied then but imports run before it
+ * @return -EIO if the transaction cannot be committed
+ * @author HP
+ */
+int control_flush(struct kwest_control *ctl)
+{
+	char *rest, *line;
+	int lineno = 0;
+	int res = 0;
+
+	pthread_mutex_lock(&ctl->lock);
+	if (ctl->len == 0) {
+		pthread_mutex_unlock(&ctl->lock);
+		return 0;
+	}
+	ctl->buf[ctl->len] = '\0';
+	rest = ctl->buf;
+
+	pthread_mutex_lock(&control_lock);
+	res = control_imports(ctl->buf);
+	if (res == 0) {
+		hold_catalog_changes(); /* till the batch is committed */
+		begin_transaction();
+		while ((line = strsep(&rest, "\n")) != NULL) {
+			lineno++;
+			res = control_run(line);
+			if (res != 0) {
+				log_msg("control: line %d failed", lineno);
+				break;
+			}
+		}
+		if (res != 0) {
+			rollback_transaction();
+		} else if (commit_transaction() != SQLITE_OK) {
+			log_msg("control: could not commit");
+			rollback_transaction();
+			res = -EIO;
+		}
+		release_catalog_changes(res == 0);
+	}
+	pathcache_flush();
+	pthread_mutex_unlock(&control_lock);
+
+	ctl->len = 0;
+	pthread_mutex_unlock(&ctl->lock);
+	return res;
+}
+
+/**
+ * @brief close control file, dropping commands not flushed
+ * @param ctl control file
+ * @return void
+ * @author HP
+ */
+void control_release(struct kwest_control *ctl)
+{
+	pthread_mutex_destroy(&ctl->lock);
+	free(ctl->buf);
+	free(ctl);
+}
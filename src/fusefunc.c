@@ -25,19 +25,152 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <sys/xattr.h>
 #include <fuse.h>
 
 #include "fusefunc.h"
 #include "dbfuse.h"
+#include "dbquery.h"
+#include "dbusage.h"
+#include "ingest.h"
+#include "fusecache.h"
+#include "fuseopts.h"
+#include "fusectl.h"
+#include "stats.h"
 #include "dbapriori.h"
 #include "apriori.h"
 #include "dbinit.h"
 #include "dbbasic.h"
+#include "dbkey.h"
 #include "logging.h"
 #include "flags.h"
 
+#define CONTROL_DIR_PATH  "/" CONTROL_DIR
+#define CONTROL_FILE_PATH "/" CONTROL_DIR "/" CONTROL_FILE
+#define STATS_FILE_PATH   "/" CONTROL_DIR "/" STATS_FILE
+
+/* FILE HANDLES
+ * backing descriptor in low bits, file id in high bits for uses of file
+ */
+#define KW_FH(fd, fno)   (((uint64_t)(uint32_t)(fno) << 32) | (uint32_t)(fd))
+#define KW_FH_FD(fh)     ((int)((fh) & 0xffffffff))
+#define KW_FH_FNO(fh)    ((int)((fh) >> 32))
+
+/**
+ * @fn static bool is_control(const char *path)
+ * @brief check if path is the control file
+ * @param path file system path
+ * @return true if path is the control file
+ * @see fusectl.c
+ * @author Harshvardhan Pandit
+ */
+static bool is_control(const char *path)
+{
+	return strcmp(path, CONTROL_FILE_PATH) == 0;
+}
+
+/**
+ * @fn static bool is_stats(const char *path)
+ * @brief check if path is the stats file
+ * @param path file system path
+ * @return true if path is the stats file
+ * @see stats.c
+ * @author Harshvardhan Pandit
+ */
+static bool is_stats(const char *path)
+{
+	return strcmp(path, STATS_FILE_PATH) == 0;
+}
+
+/**
+ * @fn static bool show_suggestions(const char *path)
+ * @brief check if suggestions are listed under path
+ * @details suggestions are shown in the user directory, and in top level
+ * tags
+ * @param path path file system path
+ * @return true if suggestions are listed
+ * @author Harshvardhan Pandit
+ */
+static bool show_suggestions(const char *path)
+{
+	bool show = true;
+	char *mypath = strdup(path + 1);
+
+	if(mypath != NULL) {
+		char *tmp = strchr(mypath,'/');
+		if(tmp != NULL) {
+			*tmp = '\0';
+			char *homedir, *username;
+
+			get_homedir(&homedir);
+			username = strrchr(homedir, '/') + 1;
+
+			show = (strcmp(mypath,username) == 0);
+		}
+		free(mypath);
+	}
+	return show;
+}
+
+/**
+ * @fn static bool is_suggest_dir(const char *path)
+ * @brief check if path names the directory of suggestions under a tag
+ * @param path file system path
+ * @return true if last component of path is SUGGEST_DIR
+ * @author Harshvardhan Pandit
+ */
+static bool is_suggest_dir(const char *path)
+{
+	return strcmp(strrchr(path, '/') + 1, SUGGEST_DIR) == 0;
+}
+
+/**
+ * @fn static int suggest_dir_tag(const char *path)
+ * @brief get tag whose suggestions are listed at path
+ * @param path file system path ending in SUGGEST_DIR
+ * @return tag id on SUCCESS
+ * @return KW_FAIL if path is not under a tag showing suggestions
+ * @author Harshvardhan Pandit
+ */
+static int suggest_dir_tag(const char *path)
+{
+	char *parent = strndup(path, strrchr(path, '/') - path);
+	int tno = KW_FAIL;
+
+	if(parent == NULL) {
+		return KW_FAIL;
+	}
+	if(*parent == '\0') {
+		tno = get_tag_id(TAG_ROOT);
+	} else if(show_suggestions(parent) == true &&
+	          check_path_validity(parent) == KW_SUCCESS &&
+	          path_is_dir(parent) == true) {
+		tno = get_tag_id(strrchr(parent, '/') + 1);
+	}
+	free(parent);
+	return tno;
+}
+
+/**
+ * @fn static void invalidate_attr(const char *path)
+ * @brief drop cached attributes of file at path
+ * @param path file system path
+ * @return void
+ * @note called by operations modifying the backing file
+ * @author Harshvardhan Pandit
+ */
+static void invalidate_attr(const char *path)
+{
+	int fno = KW_FAIL;
+
+	if(pathcache_lookup(path, &fno, NULL) == KW_PATH_FILE) {
+		statcache_invalidate(fno);
+	}
+}
 
 /**
  * @fn static int kwest_getattr(const char *path, struct stat *stbuf)
@@ -65,6 +198,31 @@ static int kwest_getattr(const char *path, struct stat *stbuf)
 		stbuf->st_nlink=1;
 		return 0;
 	}
+	/** check if path is the control file or its directory */
+	if(strcmp(path, CONTROL_DIR_PATH) == 0) {
+		stbuf->st_mode= S_IFDIR | KW_STCTLDIR;
+		stbuf->st_nlink=1;
+		return 0;
+	}
+	if(is_control(path) == true) {
+		stbuf->st_mode= S_IFREG | KW_STCTL;
+		stbuf->st_nlink=1;
+		return 0;
+	}
+	if(is_stats(path) == true) {
+		stbuf->st_mode= S_IFREG | KW_STSTATS;
+		stbuf->st_nlink=1;
+		return 0;
+	}
+	/** check if path is the directory of suggestions under a tag */
+	if(is_suggest_dir(path) == true) {
+		if(suggest_dir_tag(path) == KW_FAIL) {
+			return -ENOENT;
+		}
+		stbuf->st_mode= S_IFDIR | KW_STDIR;
+		stbuf->st_nlink=1;
+		return 0;
+	}
 	/** check is path is a virtual suggestion */
 	if(strlen(path) > 13) {
 		char *pre = strdup(strrchr(path,'/'));
@@ -120,12 +278,32 @@ static int kwest_getattr(const char *path, struct stat *stbuf)
 	/** check if path is for a file */
 	} else if(path_is_file(path) == true) {
 		/*log_msg("PATH IS FILE");*/
+		int fno = KW_FAIL;
+		/** files shown as symlinks, backing file is not looked at */
+		if(get_kwest_options()->symlinks) {
+			abspath = get_absolute_path(path);
+			if(abspath == NULL) {
+				return -EIO;
+			}
+			memset(stbuf, 0, sizeof(struct stat));
+			stbuf->st_mode = S_IFLNK | KW_STLNK;
+			stbuf->st_nlink = 1;
+			stbuf->st_size = strlen(abspath);
+			free((char *)abspath);
+			return 0;
+		}
+		/** attributes of backing file are served from stat cache */
+		if(pathcache_lookup(path, &fno, NULL) == KW_PATH_FILE &&
+		   statcache_lookup(fno, stbuf) == KW_SUCCESS) {
+			return 0;
+		}
 		abspath=get_absolute_path(path);
 		stbuf->st_mode= S_IFREG | KW_STFIL;
 		if(abspath == NULL) {
 			return -EIO;
 		}
 		if(stat(abspath,stbuf) == 0) {
+			statcache_insert(fno, stbuf);
 			free((char *)abspath);
 			return 0;
 		} else {
@@ -138,11 +316,28 @@ static int kwest_getattr(const char *path, struct stat *stbuf)
 	return -EACCES;
 }
 
-static void display_suggestions(char **suggest, char *msg, void *buf,
-                                fuse_fill_dir_t filler, struct stat st)
+/**
+ * @fn static int display_suggestions(char **suggest, const char *msg,
+ *          void *buf, fuse_fill_dir_t filler, struct stat st, int *count,
+ *          int from)
+ * @brief fill suggestions into directory listing
+ * @param suggest comma separated suggestions, freed here
+ * @param msg prefix of suggestion entries
+ * @param buf buffer to store directory entries
+ * @param filler function to fill buffer with entry
+ * @param st attributes of suggestion entries
+ * @param count number of suggestions listed before these
+ * @param from number of suggestions already returned to the kernel
+ * @return 1 if buffer is full
+ * @return 0 otherwise
+ * @author Harshvardhan Pandit
+ */
+static int display_suggestions(char **suggest, const char *msg, void *buf,
+                               fuse_fill_dir_t filler, struct stat st,
+                               int *count, int from)
 {
 	if (*suggest == NULL) {
-		return ;
+		return 0;
 	}
 
 	/*
@@ -151,7 +346,8 @@ static void display_suggestions(char **suggest, char *msg, void *buf,
 	*/
 
 	int i = 0;
-	char *entry = (char *)malloc(strlen(*suggest) * sizeof(char));
+	int full = 0;
+	char *entry = (char *)malloc((strlen(*suggest) + 1) * sizeof(char));
 	char buffer[QUERY_SIZE];
 
 	do {
@@ -159,15 +355,289 @@ static void display_suggestions(char **suggest, char *msg, void *buf,
 		if (strcmp(entry, "") == 0) {
 			break;
 		}
+		i++;
+		if ((*count)++ < from) { /* already returned */
+			continue;
+		}
 		strcpy(buffer, msg);
 		strcat(buffer, entry);
-		filler(buf, buffer, &st, 0);
-		i++;
+		if (filler(buf, buffer, &st,
+		           KW_DIROFF(KW_DIROFF_SUGGEST, *count)) == 1) {
+			full = 1;
+			break;
+		}
 	} while(1);
 
 	free((char *) entry);
 	free((char *) *suggest);
 	*suggest = NULL;
+	return full;
+}
+
+/**
+ * @fn static void get_suggestions(int tno, char **lists)
+ * @brief get suggestions for tag
+ * @details mining suggestions goes through every association rule, so they
+ * are mined once and kept in the suggestion cache until the catalog changes
+ * @param tno tag id
+ * @param lists filled with comma separated suggestions of each kind, NULL
+ * where there are none, to be freed by caller
+ * @return void
+ * @see suggestcache_lookup
+ * @author Harshvardhan Pandit
+ */
+static void get_suggestions(int tno, char **lists)
+{
+	unsigned int generation = get_catalog_generation();
+	char *tagname;
+	int i;
+
+	if(suggestcache_lookup(tno, generation, lists) == KW_SUCCESS) {
+		return;
+	}
+	tagname = (char *)get_tag_name(tno);
+	if(tagname == NULL) {
+		for(i = 0; i < KW_SUGGEST_KINDS; i++) {
+			lists[i] = NULL;
+		}
+		return;
+	}
+	lists[KW_SUGGEST_FILPR] = get_file_suggestions_pr(tagname);
+	lists[KW_SUGGEST_FILRE] = get_file_suggestions_r(tagname);
+	lists[KW_SUGGEST_TAGPR] = get_tag_suggestions_pr(tagname);
+	lists[KW_SUGGEST_TAGRE] = get_tag_suggestions_r(tagname);
+	free(tagname);
+
+	suggestcache_insert(tno, generation, lists);
+}
+
+/**
+ * @fn static int readdir_suggestions(int tno, void *buf,
+ *          fuse_fill_dir_t filler, off_t offset)
+ * @brief list suggestions for tag, as entries of its SUGGEST_DIR
+ * @param tno tag id, KW_FAIL for none
+ * @param buf buffer to store directory entries
+ * @param filler function to fill buffer with entry
+ * @param offset offset of next entry, 0 for start of listing
+ * @return 0 on SUCCESS
+ * @author Harshvardhan Pandit
+ */
+static int readdir_suggestions(int tno, void *buf, fuse_fill_dir_t filler,
+                               off_t offset)
+{
+	static const char *msg[KW_SUGGEST_KINDS] = {
+		"SUGGESTEDFILPR - ", "SUGGESTEDFILRE - ",
+		"SUGGESTEDTAGPR - ", "SUGGESTEDTAGRE - "
+	};
+	char *lists[KW_SUGGEST_KINDS];
+	struct stat st;
+	int from = 0, count = 0, full = 0;
+	int i;
+
+	if(tno == KW_FAIL) {
+		return 0;
+	}
+	if(KW_DIROFF_PART(offset) == KW_DIROFF_SUGGEST) {
+		from = KW_DIROFF_ID(offset);
+	}
+
+	get_suggestions(tno, lists);
+	memset(&st, 0, sizeof(st));
+	for(i = 0; i < KW_SUGGEST_KINDS; i++) {
+		st.st_mode = (i < KW_SUGGEST_TAGPR) ? S_IFREG | KW_STFIL :
+		                                      S_IFDIR | KW_STDIR;
+		if(full == 0) {
+			full = display_suggestions(&lists[i], msg[i], buf,
+			                           filler, st, &count, from);
+		}
+		free(lists[i]);
+	}
+	return 0;
+}
+
+/**
+ * @struct kw_usagelist
+ * @brief files under virtual tag of used files, taken as listing starts
+ * @details the order of used files changes each time uses are written,
+ * so offsets of the listing are positions in this list, kept by the
+ * cursor, and not in the database
+ */
+struct kw_usagelist {
+	int count;
+	char *names[USAGE_LIST];
+};
+
+/**
+ * @fn static void usagelist_free(struct kw_usagelist *list)
+ * @brief free files taken under virtual tag of used files
+ * @param list files, NULL for none
+ * @return void
+ * @author Harshvardhan Pandit
+ */
+static void usagelist_free(struct kw_usagelist *list)
+{
+	int i;
+
+	if(list == NULL) {
+		return;
+	}
+	for(i = 0; i < list->count; i++) {
+		free(list->names[i]);
+	}
+	free(list);
+}
+
+/**
+ * @fn static int readdir_usage(int kind, struct kw_usagelist **list,
+ *                              void *buf, fuse_fill_dir_t filler,
+ *                              off_t offset)
+ * @brief list files under virtual tag of used files
+ * @details files are taken when the listing starts, after writing uses
+ * recorded since they were last written to the database, so that the
+ * listing is up to date and does not change while it is read
+ * @param kind USAGE_RECENT or USAGE_FREQUENT
+ * @param list files taken, held by cursor of directory
+ * @param buf buffer to store directory entries
+ * @param filler function to fill buffer with entry
+ * @param offset offset of next entry, 0 for start of listing
+ * @return 0 on SUCCESS
+ * @return -ENOMEM on memory error
+ * @see dbusage.c
+ * @author Harshvardhan Pandit
+ */
+static int readdir_usage(int kind, struct kw_usagelist **list, void *buf,
+                         fuse_fill_dir_t filler, off_t offset)
+{
+	const char *direntry = NULL;
+	sqlite3_stmt *stmt = NULL;
+	struct stat st;
+	int from = 0, id;
+
+	if(KW_DIROFF_PART(offset) == KW_DIROFF_FILES) {
+		from = KW_DIROFF_ID(offset);
+	}
+	if(from == 0 || *list == NULL) {
+		usagelist_free(*list);
+		*list = calloc(1, sizeof(struct kw_usagelist));
+		if(*list == NULL) {
+			return -ENOMEM;
+		}
+		usage_flush();
+		stmt = usage_files(kind, 0);
+		while((direntry = row_from_stmt(stmt, &id)) != NULL) {
+			if((*list)->count == USAGE_LIST ||
+			   ((*list)->names[(*list)->count] =
+			    strdup(direntry)) == NULL) {
+				sqlite3_finalize(stmt);
+				break;
+			}
+			(*list)->count++;
+		}
+	}
+
+	memset(&st, 0, sizeof(st));
+	st.st_mode = get_kwest_options()->symlinks ? S_IFLNK | KW_STLNK :
+	                                             S_IFREG | KW_STFIL;
+	for(; from < (*list)->count; from++) {
+		if (filler(buf, (*list)->names[from], &st,
+		           KW_DIROFF(KW_DIROFF_FILES, from + 1)) == 1) {
+			return 0;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @struct kw_dircursor
+ * @brief tag or query being listed, resolved once on opendir
+ * @details the position within the listing is kept in the readdir offset,
+ * made of the part being listed and the id following the last entry
+ * returned. A listing continues from any offset with one query walking
+ * the index from that id, so nothing else is held between calls.
+ */
+struct kw_dircursor {
+	int tno;        /* tag listed, KW_FAIL if path is not a tag */
+	bool suggest;   /* list SUGGEST_DIR after files */
+	bool suggested; /* list suggestions for tag, path is its SUGGEST_DIR */
+	struct kw_query *query; /* query listed, NULL if path is not a query */
+	int usage;      /* virtual tag listed, KW_FAIL if path is not one */
+	struct kw_usagelist *used; /* files listed under virtual tag */
+	bool root;      /* list virtual tags of used files after files */
+};
+
+/**
+ * @fn static int kwest_opendir(const char *path, struct fuse_file_info *fi)
+ * @brief resolve tag or query to be listed
+ * @param path path file system path
+ * @param fi fuse file handle to hold cursor
+ * @return 0 on SUCCESS
+ * @return -ENOENT if path is a query not understood
+ * @return -ENOMEM on memory error
+ * @see kwest_readdir
+ * @see kwest_releasedir
+ * @author Harshvardhan Pandit
+ */
+static int kwest_opendir(const char *path, struct fuse_file_info *fi)
+{
+	struct kw_dircursor *cursor = NULL;
+	log_msg("opendir: %s",path);
+
+	if(strcmp(path, CONTROL_DIR_PATH) == 0) { /* not listed */
+		return -EACCES;
+	}
+	cursor = malloc(sizeof(struct kw_dircursor));
+	if(cursor == NULL) {
+		return -ENOMEM;
+	}
+	cursor->query = NULL;
+	cursor->used = NULL;
+	cursor->usage = usage_of_path(path);
+	cursor->root = (*(path + 1) == '\0');
+	cursor->suggested = is_suggest_dir(path);
+	if(cursor->usage != KW_FAIL) {
+		cursor->tno = KW_FAIL;
+		cursor->suggest = false;
+	} else if(is_query_path(path) == true) {
+		cursor->query = query_parse(path);
+		if(cursor->query == NULL) {
+			free(cursor);
+			return -ENOENT;
+		}
+		cursor->tno = KW_FAIL;
+		cursor->suggest = false;
+	} else if(cursor->suggested == true) {
+		cursor->tno = suggest_dir_tag(path);
+		cursor->suggest = false;
+	} else {
+		if(*(path + 1) == '\0') {
+			cursor->tno = get_tag_id(TAG_ROOT);
+		} else {
+			cursor->tno = get_tag_id(strrchr(path,'/') + 1);
+		}
+		cursor->suggest = show_suggestions(path);
+	}
+
+	fi->fh = (uintptr_t)cursor;
+	return 0;
+}
+
+/**
+ * @fn static int kwest_releasedir(const char *path,
+ *                                 struct fuse_file_info *fi)
+ * @brief free cursor held by opendir
+ * @param path path file system path
+ * @param fi fuse file handle holding cursor
+ * @return 0 on SUCCESS
+ * @author Harshvardhan Pandit
+ */
+static int kwest_releasedir(const char *path, struct fuse_file_info *fi)
+{
+	struct kw_dircursor *cursor = (struct kw_dircursor *)(uintptr_t)fi->fh;
+	log_msg("releasedir: %s",path);
+	query_free(cursor->query);
+	usagelist_free(cursor->used);
+	free(cursor);
+	return 0;
 }
 
 /**
@@ -177,9 +647,15 @@ static void display_suggestions(char **suggest, char *msg, void *buf,
  * @param path path file system path
  * @param buf buffer to store directory entries
  * @param filler function to fill buffer with entry
- * @param offset offset for last entry
- * @param fi fuse struct for file info
+ * @param offset offset of next entry, 0 for start of listing
+ * @param fi fuse file handle holding cursor from opendir
  * @note path is relative to file system
+ * @note entries are filled with their offsets, so the kernel can page
+ * through large tags and continue an interrupted listing
+ * @note suggestions are not mined here, they are listed under SUGGEST_DIR
+ * only when it is read
+ * @note a query lists only the files satisfying it, streamed from a single
+ * statement in the same order and with the same offsets as files of a tag
  * @return 0 on  SUCCESS
  * @return -ENOENT on no_entry
  * @return -EIO on IOerror
@@ -189,14 +665,23 @@ static void display_suggestions(char **suggest, char *msg, void *buf,
 static int kwest_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
                          off_t offset, struct fuse_file_info *fi)
 {
-	(void)offset;
-	(void)fi;
+	struct kw_dircursor *cursor = (struct kw_dircursor *)(uintptr_t)fi->fh;
+	int part = KW_DIROFF_PART(offset);
+	int from = KW_DIROFF_ID(offset);
 	const char *direntry = NULL;
-	char *suggest = NULL;
-	void *ptr = NULL;
+	sqlite3_stmt *stmt = NULL;
 	struct stat st;
+	int id;
 	log_msg("readdir: %s",path);
 
+	if(cursor->suggested == true) {
+		return readdir_suggestions(cursor->tno, buf, filler, offset);
+	}
+	if(cursor->usage != KW_FAIL) {
+		return readdir_usage(cursor->usage, &cursor->used, buf, filler,
+		                     offset);
+	}
+
 	/** @todo
 	 * check_path_validity(path)
 	 * that recognises a valid kwest path
@@ -212,61 +697,79 @@ static int kwest_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
 	 * filled with entries (listings) for the current readdir command
 	 * the function filler is provided by fuse
 	 */
+	if(part < KW_DIROFF_TAGS) {
+		part = KW_DIROFF_TAGS;
+		from = 0;
+	}
+	if(cursor->query != NULL && part == KW_DIROFF_TAGS) {
+		part = KW_DIROFF_FILES;
+		from = 0;
+	}
+
 	memset(&st, 0, sizeof(st));
 	st.st_mode = S_IFDIR | KW_STDIR;
 
 	/** get directories under current path */
-	while((direntry = readdir_dirs(path, &ptr)) != NULL) {
-		if (filler(buf, direntry, &st, 0) == 1) {
-			break;
+	if(part == KW_DIROFF_TAGS) {
+		stmt = get_subtags_by_tno(cursor->tno, from);
+		while((direntry = row_from_stmt(stmt, &id)) != NULL) {
+			if (filler(buf, direntry, &st,
+			           KW_DIROFF(KW_DIROFF_TAGS, id + 1)) == 1) {
+				sqlite3_finalize(stmt);
+				return 0;
+			}
 		}
+		part = KW_DIROFF_FILES;
+		from = 0;
 	}
 
-	direntry = NULL; ptr = NULL;
 	memset(&st, 0, sizeof(st));
-	st.st_mode = S_IFREG | KW_STFIL;
+	st.st_mode = get_kwest_options()->symlinks ? S_IFLNK | KW_STLNK :
+	                                             S_IFREG | KW_STFIL;
 	/** get files under current path */
-	while((direntry = readdir_files(path, &ptr)) != NULL) {
-		if (filler(buf, direntry, &st, 0) == 1) {
-			break;
+	if(part == KW_DIROFF_FILES) {
+		if(cursor->query != NULL) {
+			stmt = query_files(cursor->query, from);
+		} else {
+			stmt = get_files_by_tno(cursor->tno, from);
+		}
+		while((direntry = row_from_stmt(stmt, &id)) != NULL) {
+			if (filler(buf, direntry, &st,
+			           KW_DIROFF(KW_DIROFF_FILES, id + 1)) == 1) {
+				sqlite3_finalize(stmt);
+				return 0;
+			}
 		}
+		part = KW_DIROFF_SUGGEST;
+		from = 0;
 	}
 
-	/* Display suggestions only if in user directory */
-	char *mypath = strdup(path + 1);
-	if(mypath != NULL) {
-		char *tmp = strchr(mypath,'/');
-		if(tmp != NULL) {
-			*tmp = '\0';
-			char *homedir, *username;
-
-			get_homedir(&homedir);
-			username = strrchr(homedir, '/') + 1;
+	/* Directory of suggestions only if in user directory */
+	if(cursor->suggest == true && part == KW_DIROFF_SUGGEST && from == 0) {
+		memset(&st, 0, sizeof(st));
+		st.st_mode = S_IFDIR | KW_STDIR;
+		if(filler(buf, SUGGEST_DIR, &st,
+		          KW_DIROFF(KW_DIROFF_SUGGEST, 1)) == 1) {
+			return 0;
+		}
+	}
+	if(part < KW_DIROFF_USAGE) {
+		part = KW_DIROFF_USAGE;
+		from = 0;
+	}
 
-			if(strcmp(mypath,username) != 0) {
-				free(mypath);
+	/* Virtual tags of used files only in root */
+	if(cursor->root == true) {
+		memset(&st, 0, sizeof(st));
+		st.st_mode = S_IFDIR | KW_STDIR;
+		for(id = from; id < USAGE_KINDS; id++) {
+			if(filler(buf, usage_name(id), &st,
+			          KW_DIROFF(KW_DIROFF_USAGE, id + 1)) == 1) {
 				return 0;
 			}
 		}
-		free(mypath);
 	}
 
-	/** get probably related File suggestions under current path */
-	suggest = get_file_suggestions_pr(strrchr(path,'/') + 1);
-	display_suggestions(&suggest, "SUGGESTEDFILPR - ", buf, filler, st);
-
-	/** get related File suggestions under current path */
-	suggest = get_file_suggestions_r(strrchr(path,'/') + 1);
-	display_suggestions(&suggest, "SUGGESTEDFILRE - ", buf, filler, st);
-
-	/** get probably related Tag suggestions under current path */
-	suggest = get_tag_suggestions_pr(strrchr(path,'/') + 1);
-	display_suggestions(&suggest, "SUGGESTEDTAGPR - ", buf, filler, st);
-
-	/** get related Tag suggestions under current path */
-	suggest = get_tag_suggestions_pr(strrchr(path,'/') + 1);
-	display_suggestions(&suggest, "SUGGESTEDTAGRE - ", buf, filler, st);
-
 	/** check is path is a virtual suggestion */
 	/*
 	if(strlen(path) > 13) {
@@ -359,6 +862,54 @@ static int kwest_access(const char *path, int mask)
 	return 0;
 }
 
+/**
+ * @fn static int kwest_statfs(const char *path, struct statvfs *stbuf)
+ * @brief get filesystem statistics
+ * @details answered from counts kept in memory, without a database query
+ * @param path path of file system
+ * @param stbuf structure statvfs
+ * @return 0 on SUCCESS
+ * @see get_statfs
+ * @author Harshvardhan Pandit
+ */
+static int kwest_statfs(const char *path, struct statvfs *stbuf)
+{
+	(void)path;
+	get_statfs(stbuf);
+	return 0;
+}
+
+
+/**
+ * @fn static void *kwest_init(struct fuse_conn_info *conn)
+ * @brief negotiate capabilities with the kernel on mount
+ * @details asks for replies to be spliced into /dev/fuse, so that data of
+ * backing files returned by kwest_read_buf is moved without being copied
+ * through the daemon
+ * @param conn connection capabilities
+ * @return NULL as private data
+ * @see kwest_read_buf
+ * @author Harshvardhan Pandit
+ */
+static void *kwest_init(struct fuse_conn_info *conn)
+{
+	if(conn->capable & FUSE_CAP_SPLICE_WRITE) {
+		conn->want |= FUSE_CAP_SPLICE_WRITE;
+	}
+	if(conn->capable & FUSE_CAP_SPLICE_MOVE) {
+		conn->want |= FUSE_CAP_SPLICE_MOVE;
+	}
+	log_msg("init: splice %s", (conn->want & FUSE_CAP_SPLICE_WRITE) ?
+	        "on" : "off");
+
+	if(usage_start() != KW_SUCCESS) {
+		log_msg("init: uses of files written only when listed");
+	}
+	if(ingest_start() != KW_SUCCESS) {
+		log_msg("init: metadata of written files not extracted");
+	}
+	return NULL;
+}
 
 /**
  * @fn void kwest_destroy(void *private_data)
@@ -375,6 +926,8 @@ void kwest_destroy(void *private_data)
 {
 	(void)private_data;
 	log_msg("filesytem is being unmounted...");
+	usage_stop();
+	ingest_stop();
 	close_db();
 	log_close();
 }
@@ -400,6 +953,13 @@ int kwest_mkdir(const char *path, mode_t mode)
 {
 	log_msg("mkdir: %s",path);
 
+	/** query results are not tags, nor are tags made to look like one,
+	 * or named as virtual tags of root */
+	if(is_query_path(path) == true || usage_of_path(path) != KW_FAIL ||
+	   usage_of_path(strrchr(path, '/')) != KW_FAIL ||
+	   is_query_component(strrchr(path, '/') + 1) == true) {
+		return -EPERM;
+	}
 	if(check_path_validity(path) == KW_SUCCESS) {
 		log_msg("PATH NOT VALID");
 		return -ENOENT;
@@ -422,6 +982,9 @@ int kwest_rmdir(const char *path)
 {
 	log_msg("rmdir: %s",path);
 
+	if(is_query_path(path) == true || usage_of_path(path) != KW_FAIL) {
+		return -EPERM;
+	}
 	if(check_path_validity(path) != KW_SUCCESS) {
 		log_msg("PATH NOT VALID");
 		return -ENOENT;
@@ -434,38 +997,51 @@ int kwest_rmdir(const char *path)
 
 /* FILE FUNCTIONS */
 
-static char *get_cp_path()
-{
-	static char cppath[QUERY_SIZE];
-	return cppath;
-}
-
 /**
  * @fn static int kwest_open(const char *path, struct fuse_file_info *fi)
  * @brief open a file for read/write operations
+ * @details the backing file is opened once here and its descriptor is kept
+ * in fi->fh with the file id, so that read and write do not have to resolve
+ * the path again
  * @param path path of file system
  * @param fi fuse file handle
  * @return 0 on SUCCESS
  * @return -errno on error
+ * @see kwest_release
  * @author Harshvardhan Pandit
  */
 static int kwest_open(const char *path, struct fuse_file_info *fi)
 {
 	int res;
+	int fno = KW_FAIL;
 	const char *abspath = NULL;
 	log_msg("open: %s",path);
 
-	char *cppath = get_cp_path();
-	/*
-	if (strcmp(strrchr(cppath,'/')+1,strrchr(path,'/')+1) == 0) {
-		log_msg("file double open error");
+	/** control file only takes commands, see fusectl.c */
+	if(is_control(path) == true) {
+		if((fi->flags & O_ACCMODE) != O_WRONLY) {
+			return -EACCES;
+		}
+		fi->fh = (uintptr_t)control_open();
+		if(fi->fh == 0) {
+			return -ENOMEM;
+		}
+		fi->direct_io = 1;
 		return 0;
-	} else {
-		*/
-		cppath = strcpy(cppath, path);
-		log_msg("cppath: %s",cppath);
-	//}
-	
+	}
+	/** stats file is read from a report made on open, see stats.c */
+	if(is_stats(path) == true) {
+		if((fi->flags & O_ACCMODE) != O_RDONLY) {
+			return -EACCES;
+		}
+		fi->fh = (uintptr_t)stats_report(NULL);
+		if(fi->fh == 0) {
+			return -ENOMEM;
+		}
+		fi->direct_io = 1;
+		return 0;
+	}
+
 	/** check is path is a virtual suggestion */
 	if(strlen(path) > 13) {
 		char *pre = strdup(strrchr(path,'/'));
@@ -483,14 +1059,16 @@ static int kwest_open(const char *path, struct fuse_file_info *fi)
 			}
 
 			res = open(abspath, fi->flags);
+			free((char *)abspath);
 			if (res == -1) {
+				res = -errno;
 				log_msg("COULD NOT OPEN FILE");
 				free(pre);
-				return -errno;
+				return res;
 			}
 
 			free(pre);
-			close(res);
+			fi->fh = KW_FH(res, KW_FAIL);
 			return 0;
 		}
 		free(pre);
@@ -501,21 +1079,90 @@ static int kwest_open(const char *path, struct fuse_file_info *fi)
 		return -ENOENT;
 	}
 
-
-	abspath = get_absolute_path(cppath); /* get absolute path on disk */
+	abspath = get_absolute_path(path); /* get absolute path on disk */
 	if(abspath == NULL) {
 		log_msg("ABSOLUTE PATH ERROR");
 		//return -EIO;
+		fi->fh = KW_NOFH;
 		return 0;
 	}
 
 	res = open(abspath, fi->flags); /* open system call */
+	free((char *)abspath);
 	if (res == -1) {
+		res = -errno;
 		log_msg("COULD NOT OPEN FILE");
-		return -errno;
+		return res;
 	}
 
-	close(res);
+	/** file id is kept in handle, so reads are recorded without lookups */
+	if(pathcache_lookup(path, &fno, NULL) != KW_PATH_FILE) {
+		fno = get_file_id(strrchr(path, '/') + 1);
+	}
+	usage_open(fno);
+	if((fi->flags & O_ACCMODE) != O_RDONLY) {
+		ingest_open(fno, res);
+	}
+
+	fi->fh = KW_FH(res, fno); /* kept open till kwest_release */
+	return 0;
+}
+
+
+/**
+ * @fn static int kwest_create(const char *path, mode_t mode,
+ *                             struct fuse_file_info *fi)
+ * @brief create and open a file
+ * @details a name not in kwest is a new file, created on disk in the store
+ * directory and added to kwest under the parent tag. A name in kwest is
+ * another file, whose data is never opened for a create: the kernel only
+ * creates names not found under the parent tag, so the file is elsewhere
+ * and ln or cp -l tag it here, see kwest_link.
+ * @param path path of file system
+ * @param mode mode of file
+ * @param fi fuse file handle
+ * @return 0 on SUCCESS
+ * @return -EEXIST if name is a file in kwest
+ * @return -errno on error
+ * @see create_this_file
+ * @see kwest_open
+ * @author Harshvardhan Pandit
+ */
+static int kwest_create(const char *path, mode_t mode,
+                        struct fuse_file_info *fi)
+{
+	const char *name = strrchr(path, '/') + 1;
+	int fno;
+	int res;
+	log_msg("create: %s",path);
+
+	if(strncmp(path, CONTROL_DIR_PATH "/", strlen(CONTROL_DIR_PATH "/"))
+	   == 0) {
+		return -EACCES;
+	}
+	if(is_query_path(path) == true || usage_of_path(path) != KW_FAIL) {
+		return -EPERM;
+	}
+	/** files of root are under no tag to be checked */
+	if(name - 1 != path && check_path_tags_validity(path) != KW_SUCCESS) {
+		log_msg("PATH NOT VALID");
+		return -ENOENT;
+	}
+
+	if(get_file_id(name) != KW_FAIL) {
+		log_msg("%s already in kwest", name);
+		return -EEXIST;
+	}
+	res = create_this_file(path, mode, fi->flags);
+	if(res < 0) {
+		return res;
+	}
+
+	fno = get_file_id(name);
+	usage_open(fno);
+	ingest_open(fno, res);
+	ingest_written(fno); /* new files are always extracted */
+	fi->fh = KW_FH(res, fno); /* kept open till kwest_release */
 	return 0;
 }
 
@@ -523,19 +1170,140 @@ static int kwest_open(const char *path, struct fuse_file_info *fi)
 /**
  * @fn static int kwest_release(const char *path, struct fuse_file_info *fi)
  * @brief called when last handle to file is closed
+ * @details closes the backing file descriptor opened by kwest_open. Files
+ * written through the handle are queued for extraction of their metadata.
  * @param path path of file system
  * @param fi fuse file handle
  * @return 0 on SUCCESS
  * @return -errno on  error
+ * @see kwest_open
  * @author Harshvardhan Pandit
  */
 static int kwest_release(const char *path, struct fuse_file_info *fi)
 {
-	(void)fi;
-	/* Just a stub.	 This method is optional and can safely be left
-	   unimplemented */
+	struct stat st;
 	log_msg("release: %s",path);
-	
+
+	if(fi->fh == KW_NOFH) {
+		return 0;
+	}
+	if(is_control(path) == true) {
+		control_release((struct kwest_control *)(uintptr_t)fi->fh);
+		return 0;
+	}
+	if(is_stats(path) == true) {
+		free((char *)(uintptr_t)fi->fh);
+		return 0;
+	}
+
+	if((fi->flags & O_ACCMODE) != O_RDONLY) {
+		if(fstat(KW_FH_FD(fi->fh), &st) == 0) {
+			count_file_size(KW_FH_FNO(fi->fh), st.st_size);
+		}
+		ingest_close(KW_FH_FNO(fi->fh), KW_FH_FD(fi->fh));
+	}
+	if(close(KW_FH_FD(fi->fh)) == -1) {
+		log_msg("COULD NOT CLOSE FILE");
+		return -errno;
+	}
+	fi->fh = KW_NOFH;
+	return 0;
+}
+
+
+/**
+ * @fn static int kwest_flush(const char *path, struct fuse_file_info *fi)
+ * @brief called on each close of a file
+ * @details runs commands written to the control file, so that close
+ * reports whether they were applied
+ * @param path path of file system
+ * @param fi fuse file handle
+ * @return 0 on SUCCESS
+ * @return -errno on error
+ * @see control_flush
+ * @author Harshvardhan Pandit
+ */
+static int kwest_flush(const char *path, struct fuse_file_info *fi)
+{
+	if(is_control(path) == true) {
+		return control_flush((struct kwest_control *)(uintptr_t)fi->fh);
+	}
+	if(is_stats(path) == true || fi->fh == KW_NOFH) {
+		return 0;
+	}
+	/** errors of writes held back by the backing file system are
+	 * reported on close of a duplicate, leaving the handle open */
+	if(close(dup(KW_FH_FD(fi->fh))) == -1) {
+		return -errno;
+	}
+	return 0;
+}
+
+
+/**
+ * @fn static int kwest_fsync(const char *path, int datasync,
+ *                            struct fuse_file_info *fi)
+ * @brief write data of file held in memory to disk
+ * @param path path of file system
+ * @param datasync only data is written, not attributes, if not zero
+ * @param fi fuse file handle holding descriptor from kwest_open
+ * @return 0 on SUCCESS
+ * @return -errno on error
+ * @author Harshvardhan Pandit
+ */
+static int kwest_fsync(const char *path, int datasync,
+                       struct fuse_file_info *fi)
+{
+	int res;
+
+	log_msg("fsync: %s",path);
+
+	if(is_control(path) == true || is_stats(path) == true ||
+	   fi->fh == KW_NOFH) {
+		return 0;
+	}
+	res = datasync ? fdatasync(KW_FH_FD(fi->fh)) : fsync(KW_FH_FD(fi->fh));
+	if(res == -1) {
+		return -errno;
+	}
+	return 0;
+}
+
+
+/**
+ * @fn static int kwest_readlink(const char *path, char *buf, size_t size)
+ * @brief read target of file shown as symlink
+ * @details with the symlinks option, files are symlinks to their backing
+ * files, so applications open the backing file directly and its data is
+ * never read or written through kwest
+ * @param path path of file system
+ * @param buf buffer to hold target, terminated and truncated to size
+ * @param size size of buffer
+ * @return 0 on SUCCESS
+ * @return -errno on error
+ * @author Harshvardhan Pandit
+ */
+static int kwest_readlink(const char *path, char *buf, size_t size)
+{
+	const char *abspath = NULL;
+	log_msg("readlink: %s",path);
+
+	if(check_path_validity(path) != KW_SUCCESS) {
+		log_msg("PATH NOT VALID");
+		return -ENOENT;
+	}
+	if(!get_kwest_options()->symlinks || path_is_file(path) != true) {
+		return -EINVAL;
+	}
+
+	abspath = get_absolute_path(path);
+	if(abspath == NULL) {
+		log_msg("ABSOLUTE PATH ERROR");
+		return -EIO;
+	}
+	strncpy(buf, abspath, size - 1);
+	buf[size - 1] = '\0';
+	free((char *)abspath);
 	return 0;
 }
 
@@ -544,49 +1312,48 @@ static int kwest_release(const char *path, struct fuse_file_info *fi)
  * @fn static int kwest_mknod(const char *path, mode_t mode, dev_t rdev)
  * @brief called when creating a new file
  * @details mknod functionality when called from out of the file system
- * by and external entity is not yet determined
+ * by and external entity is not yet determined. A regular file of a name
+ * not in kwest is created as by kwest_create. A name in kwest is another
+ * file, which ln or cp -l tag under the parent tag, see kwest_link.
  * @param path path of file system
  * @param mode file permissions and mode
  * @param dev creation mode
  * @return 0 on SUCCESS
+ * @return -EEXIST if name is a file in kwest
+ * @return -EPERM if file is not a regular file
  * @return -errno on error
  * @author Harshvardhan Pandit
  */
 static int kwest_mknod(const char *path, mode_t mode, dev_t rdev)
 {
-	/** @todo
-	 * kwest_mknod: create new file directly into file system?
-	 */
 	/** @todo
 	 * kwest_mknod: what happens when utilities such as the browser want
 	 * to create temporar files to work with cp/mv
 	 */
 
-	/** @bug
-	 * cp/mv does not work correctly due to improper implementation of
-	 * kwest_mknod. cp/mv will work correctly when it is from kwest
-	 * to any other filesystem. internal working is buggy / incorrect.
-	 */
-	(void)mode;
 	(void)rdev;
-	char *path2 = NULL;
-	const char *abspath = get_absolute_path(path);
+	int res;
 	log_msg("mknod: %s",path);
 
-	char *cppath = get_cp_path();
-
-	if(check_path_tags_validity(path) != KW_SUCCESS) {
+	if(strrchr(path, '/') != path &&
+	   check_path_tags_validity(path) != KW_SUCCESS) {
 		log_msg("PATH NOT VALID");
 		return -ENOENT;
 	}
 
-	if(abspath == NULL) {
-		log_msg("ABSOLUTE PATH ERROR");
-		return -EIO;
+	if(get_file_id(strrchr(path, '/') + 1) != KW_FAIL) {
+		return -EEXIST;
+	}
+	if(!S_ISREG(mode)) {
+		return -EPERM;
+	}
+	/** a regular file not in kwest is created, as by kwest_create */
+	res = create_this_file(path, mode, O_WRONLY);
+	if(res < 0) {
+		return res;
 	}
-	path2 = strdup(path);
-	rename_this_file(cppath, path2, DBFUSE_CP);
-	free(path2);
+	close(res);
+	ingest_queue(get_file_id(strrchr(path, '/') + 1));
 	
 	/*
 	if (S_ISREG(mode)) { 
@@ -624,6 +1391,10 @@ static int kwest_rename(const char *from, const char *to)
 {
 	log_msg("rename: %s to %s",from,to);
 
+	if(is_query_path(from) == true || is_query_path(to) == true ||
+	   usage_of_path(from) != KW_FAIL || usage_of_path(to) != KW_FAIL) {
+		return -EPERM;
+	}
 	if(check_path_validity(from) != KW_SUCCESS) {
 		log_msg("PATH NOT VALID");
 		return -ENOENT;
@@ -633,6 +1404,42 @@ static int kwest_rename(const char *from, const char *to)
 }
 
 
+/**
+ * @fn static int kwest_link(const char *from, const char *to)
+ * @brief hard link a file under another tag
+ * @details a link is the same file tagged once more, so only the catalog
+ * changes and no data is copied. The name of the link must be the name
+ * of the file, kwest having a single name per file.
+ * @param from path of file linked
+ * @param to path of link
+ * @return 0 on SUCCESS
+ * @return -errno on error
+ * @author Harshvardhan Pandit
+ */
+static int kwest_link(const char *from, const char *to)
+{
+	int res;
+	log_msg("link: %s to %s",from,to);
+
+	if(check_path_validity(from) != KW_SUCCESS ||
+	   check_path_tags_validity(to) != KW_SUCCESS) {
+		log_msg("PATH NOT VALID");
+		return -ENOENT;
+	}
+	if(strcmp(strrchr(from, '/'), strrchr(to, '/')) != 0) {
+		return -EPERM;
+	}
+
+	res = copy_this_file(to);
+	if(res == -EPERM) {
+		return res;
+	} else if(res != KW_SUCCESS) {
+		return -EIO;
+	}
+	return 0;
+}
+
+
 /**
  * @fn static int kwest_unlink(const char *path)
  * @brief remove file entry from system
@@ -646,6 +1453,10 @@ static int kwest_unlink(const char *path)
 
 	log_msg("unlink: %s",path);
 
+	/** files under a query have no single tag to be removed from */
+	if(is_query_path(path) == true || usage_of_path(path) != KW_FAIL) {
+		return -EPERM;
+	}
 	if(check_path_validity(path) != KW_SUCCESS) {
 		log_msg("PATH NOT VALID");
 		return -ENOENT;
@@ -655,6 +1466,33 @@ static int kwest_unlink(const char *path)
 }
 
 
+/**
+ * @fn static int read_stats(struct fuse_file_info *fi, char *buf,
+ *                           size_t size, off_t offset)
+ * @brief read report held by stats file handle
+ * @param fi fuse file handle holding report from kwest_open
+ * @param buf buffer to hold bytes
+ * @param size size of data to be read
+ * @param offset offset of data in report
+ * @return number of bytes read
+ * @author Harshvardhan Pandit
+ */
+static int read_stats(struct fuse_file_info *fi, char *buf, size_t size,
+                      off_t offset)
+{
+	const char *report = (const char *)(uintptr_t)fi->fh;
+	size_t len = strlen(report);
+
+	if ((size_t)offset >= len) {
+		return 0;
+	}
+	if (size > len - offset) {
+		size = len - offset;
+	}
+	memcpy(buf, report + offset, size);
+	return size;
+}
+
 /**
  * @fn static int kwest_read(const char *path, char *buf, size_t size,
  *                           off_t offset, struct fuse_file_info *fi)
@@ -663,83 +1501,83 @@ static int kwest_unlink(const char *path)
  * @param buf buffer to hold bytes
  * @param size size of data to be read
  * @param offset offset of last read
- * @param fi fuse file handle
- * @return 0 on SUCCESS
+ * @param fi fuse file handle holding descriptor from kwest_open
+ * @return number of bytes read on SUCCESS
  * @return -errno on error
  * @author Harshvardhan Pandit
  */
 static int kwest_read(const char *path, char *buf, size_t size, off_t offset,
 		    struct fuse_file_info *fi)
 {
-	(void)fi;
-	int fd = 0;
 	int res = 0;
-	const char *abspath = NULL;
-	char *readfile = get_cp_path();
-	strcpy(readfile, path);
 	log_msg ("read: %s",path);
 
-	/** check is path is a virtual suggestion */
-	if(strlen(path) > 13) {
-		char *pre = strdup(strrchr(path,'/'));
-		*(pre + 13) = '\0';
-		if(strcmp(pre,"/SUGGESTEDFIL" ) == 0) {
-			free(pre);
-
-			pre = strdup(strrchr(path,'/'));
-
-			abspath=get_abspath_by_fname(pre + 18);
-			if(abspath == NULL) {
-				log_msg("ABSOLUTE PATH ERROR");
-				free(pre);
-				return -EIO;
-			}
-
-			fd = open(abspath, O_RDONLY); /* open file for reading */
-			if (fd == -1) {
-				log_msg("COULD NOT OPEN FILE");
-				free(pre);
-				return -errno;
-			}
+	if(is_stats(path) == true) {
+		return read_stats(fi, buf, size, offset);
+	}
+	usage_read(KW_FH_FNO(fi->fh));
+	res = pread(KW_FH_FD(fi->fh), buf, size, offset); /* doesn't lock file */
+	if (res == -1) {
+		log_msg("FILE READ ERROR");
+		res = -errno;
+	}
 
-			res = pread(fd, buf, size, offset); /* pread doesn't lock file */
-			if (res == -1) {
-				log_msg("FILE READ ERROR");
-				res = -errno;
-			}
+	return res;
+}
 
-			free(pre);
-			close(fd);
-			return res;
-		}
-		free(pre);
-	}
 
-	if(check_path_validity(path) != KW_SUCCESS) {
-		log_msg("PATH NOT VALID");
-		return -ENOENT;
-	}
+/**
+ * @fn static int kwest_read_buf(const char *path, struct fuse_bufvec **bufp,
+ *                               size_t size, off_t offset,
+ *                               struct fuse_file_info *fi)
+ * @brief read specified bytes from file without copying them
+ * @details the buffer names the backing file descriptor and offset instead
+ * of holding data, so fuse can splice pages of the backing file into the
+ * reply. Without splice, fuse reads the descriptor itself as kwest_read.
+ * @param path path of file system
+ * @param bufp set to buffer describing data to be read
+ * @param size size of data to be read
+ * @param offset offset of data in file
+ * @param fi fuse file handle holding descriptor from kwest_open
+ * @return 0 on SUCCESS
+ * @return -errno on error
+ * @see kwest_init
+ * @author Harshvardhan Pandit
+ */
+static int kwest_read_buf(const char *path, struct fuse_bufvec **bufp,
+                          size_t size, off_t offset, struct fuse_file_info *fi)
+{
+	struct fuse_bufvec *src = NULL;
+	log_msg ("read_buf: %s",path);
 
-	abspath = get_absolute_path(path);
-	if(abspath == NULL) {
-		log_msg("ABSOLUTE PATH ERROR");
-		return -EIO;
+	if (fi->fh == KW_NOFH) {
+		return -EBADF;
 	}
 
-	fd = open(abspath, O_RDONLY); /* open file for reading */
-	if (fd == -1) {
-		log_msg("COULD NOT OPEN FILE");
-		return -errno;
+	src = malloc(sizeof(struct fuse_bufvec)); /* freed by fuse */
+	if (src == NULL) {
+		return -ENOMEM;
 	}
 
-	res = pread(fd, buf, size, offset); /* pread doesn't lock file */
-	if (res == -1) {
-		log_msg("FILE READ ERROR");
-		res = -errno;
+	*src = FUSE_BUFVEC_INIT(size);
+	if (is_stats(path) == true) { /* memory is freed by fuse as well */
+		src->buf[0].mem = malloc(size);
+		if (src->buf[0].mem == NULL) {
+			free(src);
+			return -ENOMEM;
+		}
+		src->buf[0].size = read_stats(fi, src->buf[0].mem, size,
+		                              offset);
+		*bufp = src;
+		return 0;
 	}
+	usage_read(KW_FH_FNO(fi->fh));
+	src->buf[0].flags = FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK;
+	src->buf[0].fd = KW_FH_FD(fi->fh);
+	src->buf[0].pos = offset;
 
-	close(fd);
-	return res;
+	*bufp = src;
+	return 0;
 }
 
 
@@ -751,47 +1589,30 @@ static int kwest_read(const char *path, char *buf, size_t size, off_t offset,
  * @param buf buffer to hold bytes
  * @param size size of data to be written
  * @param offset offset of last read
- * @param fi fuse file handle
- * @return 0 on SUCCESS
+ * @param fi fuse file handle holding descriptor from kwest_open
+ * @return number of bytes written on SUCCESS
  * @return -errno on error
  * @author Harshvardhan Pandit
  */
 static int kwest_write(const char *path, const char *buf, size_t size,
                        off_t offset, struct fuse_file_info *fi)
 {
-	(void)fi;
-	int fd = 0;
 	int res = 0;
-	const char *abspath = NULL;
-	char *writefile = get_cp_path();
-	if (strcmp(strrchr(writefile,'/')+1,strrchr(path,'/')+1) == 0) {
-		log_msg("internal write op");
-		return size;
-	}
 
 	log_msg ("write: %s",path);
 
-	if(check_path_validity(path) != KW_SUCCESS) {
-		log_msg("PATH NOT VALID");
-		return -ENOENT;
+	if(is_control(path) == true) {
+		return control_write((struct kwest_control *)(uintptr_t)fi->fh,
+		                     buf, size);
 	}
-
-	abspath = get_absolute_path(path);
-	if(abspath == NULL) {
-		return -EIO;
-	}
-
-	fd = open(abspath, O_WRONLY); /* open file for writing */
-	if (fd == -1) {
-		return -errno;
-	}
-
-	res = pwrite(fd, buf, size, offset); /* pwrite system call */
+	res = pwrite(KW_FH_FD(fi->fh), buf, size, offset);
 	if (res == -1) {
 		res = -errno;
+	} else {
+		ingest_written(KW_FH_FNO(fi->fh));
 	}
+	invalidate_attr(path);
 
-	close(fd);
 	return res;
 }
 
@@ -810,12 +1631,10 @@ static int kwest_truncate(const char *path, off_t size)
 	log_msg("truncate: %s", path);
 
 	int res;
+	int fno = KW_FAIL;
 
 	const char *abspath = NULL;
-	char *truncatefile = get_cp_path();
-	//log_msg("cppath: %s", truncatefile);
-	if (strcmp(strrchr(truncatefile,'/')+1,strrchr(path,'/')+1) == 0) {
-		log_msg("internal write op");
+	if(is_control(path) == true) { /* opened with O_TRUNC */
 		return 0;
 	}
 	if(check_path_validity(path) != KW_SUCCESS) {
@@ -830,10 +1649,62 @@ static int kwest_truncate(const char *path, off_t size)
 	}
 
 	res = truncate(abspath, size);
+	free((char *)abspath);
 	if (res == -1) {
 		log_msg("TRUNCATE FILE ERROR");
 		return -errno;
 	}
+	if(pathcache_lookup(path, &fno, NULL) != KW_PATH_FILE) {
+		fno = get_file_id(strrchr(path, '/') + 1);
+	}
+	count_file_size(fno, size);
+	ingest_written(fno);
+	invalidate_attr(path);
+
+	return 0;
+}
+
+
+/**
+ * @fn static int kwest_utimens(const char *path,
+ *                              const struct timespec tv[2])
+ * @brief change access and modification times of file
+ * @details times are set on the backing file, so that applications
+ * comparing modification times, like make and rsync, see those of the data
+ * @param path path of file system
+ * @param tv access and modification times, UTIME_NOW or UTIME_OMIT
+ * @return 0 on SUCCESS
+ * @return -errno on error
+ * @author Harshvardhan Pandit
+ */
+static int kwest_utimens(const char *path, const struct timespec tv[2])
+{
+	int res;
+	const char *abspath = NULL;
+
+	log_msg ("utimens: %s",path);
+
+	if(is_control(path) == true || is_stats(path) == true) {
+		return 0;
+	}
+	if(check_path_validity(path) != KW_SUCCESS) {
+		log_msg("PATH NOT VALID");
+		return -ENOENT;
+	}
+	if(path_is_dir(path) == true) { /* tags have no times */
+		return 0;
+	}
+
+	abspath = get_absolute_path(path);
+	if(abspath == NULL) {
+		return -EIO;
+	}
+	res = utimensat(AT_FDCWD, abspath, tv, 0);
+	free((char *)abspath);
+	if (res == -1) {
+		return -errno;
+	}
+	invalidate_attr(path);
 
 	return 0;
 }
@@ -869,6 +1740,7 @@ static int kwest_chmod(const char *path, mode_t mode)
 	if (res == -1) {
 		return -errno;
 	}
+	invalidate_attr(path);
 
 	return 0;
 }
@@ -904,11 +1776,132 @@ static int kwest_chown(const char *path, uid_t uid, gid_t gid)
 	res = lchown(abspath, uid, gid);
 	if (res == -1)
 		return -errno;
+	invalidate_attr(path);
 
 	return 0;
 }
 
 
+/**
+ * @fn static int xattr_fno(const char *path)
+ * @brief get id of file at path for extended attribute operations
+ * @details the file is found by its name, kwest holding one file per
+ * name, so the tags in path are not validated
+ * @param path file system path
+ * @return file id on SUCCESS
+ * @return KW_FAIL if path is not a file
+ * @author Harshvardhan Pandit
+ */
+static int xattr_fno(const char *path)
+{
+	int fno = KW_FAIL;
+
+	if(is_control(path) == true) {
+		return KW_FAIL;
+	}
+	if(pathcache_lookup(path, &fno, NULL) == KW_PATH_FILE) {
+		return fno;
+	}
+	return get_file_id(strrchr(path, '/') + 1);
+}
+
+/**
+ * @fn static int kwest_setxattr(const char *path, const char *name,
+ *                               const char *value, size_t size, int flags)
+ * @brief set extended attribute
+ * @details writing XATTR_TAGS replaces the tags of the file by the comma
+ * separated tags in value at once, without a rename per tag
+ * @param path path of file system
+ * @param name name of attribute
+ * @param value value of attribute
+ * @param size size of value
+ * @param flags XATTR_CREATE or XATTR_REPLACE
+ * @return 0 on SUCCESS
+ * @return -errno on error
+ * @author Harshvardhan Pandit
+ */
+static int kwest_setxattr(const char *path, const char *name,
+                          const char *value, size_t size, int flags)
+{
+	int fno = xattr_fno(path);
+	log_msg("setxattr: %s %s",path,name);
+
+	if(fno == KW_FAIL || strcmp(name, XATTR_TAGS) != 0) {
+		return -ENOTSUP;
+	}
+	if(flags & XATTR_CREATE) { /* file always has tags */
+		return -EEXIST;
+	}
+	return set_tags_xattr(fno, value, size);
+}
+
+/**
+ * @fn static int kwest_getxattr(const char *path, const char *name,
+ *                               char *value, size_t size)
+ * @brief get extended attribute
+ * @details XATTR_TAGS holds the comma separated tags of the file
+ * @param path path of file system
+ * @param name name of attribute
+ * @param value buffer to hold value
+ * @param size size of buffer, 0 to get size of value
+ * @return size of value on SUCCESS
+ * @return -errno on error
+ * @author Harshvardhan Pandit
+ */
+static int kwest_getxattr(const char *path, const char *name, char *value,
+                          size_t size)
+{
+	int fno;
+
+	if(strcmp(name, XATTR_TAGS) != 0 ||
+	   (fno = xattr_fno(path)) == KW_FAIL) {
+		return -ENODATA;
+	}
+	return get_tags_xattr(fno, value, size);
+}
+
+/**
+ * @fn static int kwest_listxattr(const char *path, char *list, size_t size)
+ * @brief list extended attributes, files have XATTR_TAGS only
+ * @param path path of file system
+ * @param list buffer to hold names of attributes
+ * @param size size of buffer, 0 to get size of list
+ * @return size of list on SUCCESS
+ * @return -errno on error
+ * @author Harshvardhan Pandit
+ */
+static int kwest_listxattr(const char *path, char *list, size_t size)
+{
+	if(xattr_fno(path) == KW_FAIL) {
+		return 0;
+	}
+	if(size == 0) {
+		return sizeof(XATTR_TAGS);
+	}
+	if(size < sizeof(XATTR_TAGS)) {
+		return -ERANGE;
+	}
+	memcpy(list, XATTR_TAGS, sizeof(XATTR_TAGS));
+	return sizeof(XATTR_TAGS);
+}
+
+/**
+ * @fn static int kwest_removexattr(const char *path, const char *name)
+ * @brief remove extended attribute
+ * @note a file is never without tags, so XATTR_TAGS cannot be removed
+ * @param path path of file system
+ * @param name name of attribute
+ * @return -errno
+ * @author Harshvardhan Pandit
+ */
+static int kwest_removexattr(const char *path, const char *name)
+{
+	if(strcmp(name, XATTR_TAGS) != 0 || xattr_fno(path) == KW_FAIL) {
+		return -ENODATA;
+	}
+	return -EPERM;
+}
+
 
 /* __FUSE FILESYSTEM OPERATIONS STRUCTURE__ */
 
@@ -919,87 +1912,318 @@ static int kwest_chown(const char *path, uid_t uid, gid_t gid)
  * @details implemented operations:
  @code
   	.getattr	 = kwest_getattr,
+	.opendir	 = kwest_opendir,
 	.readdir	 = kwest_readdir,
+	.releasedir	 = kwest_releasedir,
 	.access		 = kwest_access,
 	.truncate	 = kwest_truncate,
+	.utimens	 = kwest_utimens,
+	.statfs		 = kwest_statfs,
+	.init		 = kwest_init,
 	.destroy	 = kwest_destroy,
 
 FILE RELATED FILESYSTEM OPERATIONS
 	.open		= kwest_open,
 	.release	= kwest_release,
+	.flush		= kwest_flush,
+	.fsync		= kwest_fsync,
+	.readlink	= kwest_readlink,
 	.mknod		= kwest_mknod,
+	.create		= kwest_create,
 	.rename		= kwest_rename,
+	.link		= kwest_link,
 	.unlink		= kwest_unlink,
 	.read		= kwest_read,
+	.read_buf	= kwest_read_buf,
 	.write		= kwest_write,
 	.chmod		= kwest_chmod,
 	.chown		= kwest_chown,
 
+EXTENDED ATTRIBUTES
+	.setxattr	= kwest_setxattr,
+	.getxattr	= kwest_getxattr,
+	.listxattr	= kwest_listxattr,
+	.removexattr	= kwest_removexattr,
+
 DIRECTORY RELATED FILESYSTEM OPERATIONS
 	.mkdir		= kwest_mkdir,
 	.rmdir		= kwest_rmdir,
 
 NOT IMPLEMENTED
 	.symlink	= kwest_symlink,
-	.readlink	= kwest_readlink,
-	.link		= kwest_link,
-	.utimens	= kwest_utimens,
-	.statfs		= kwest_statfs,
-	.fsync		= kwest_fsync,
-
-#ifdef HAVE_SETXATTR
-	.setxattr	= kwest_setxattr,
-	.getxattr	= kwest_getxattr,
-	.listxattr	= kwest_listxattr,
-	.removexattr	= kwest_removexattr,
-#endif
 @endcode
 */
 static struct fuse_operations kwest_oper = {
 /* BASIC FILESYSTEM OPERATIONS */
 	.getattr	 = kwest_getattr,
+	.opendir	 = kwest_opendir,
 	.readdir	 = kwest_readdir,
+	.releasedir	 = kwest_releasedir,
 	.access		 = kwest_access,
 	.truncate	 = kwest_truncate,
+	.utimens	 = kwest_utimens,
+	.statfs		 = kwest_statfs,
+	.init		 = kwest_init,
 	.destroy	 = kwest_destroy,
 
 /* FILE RELATED FILESYSTEM OPERATIONS */
 	.open		= kwest_open,
 	.release	= kwest_release,
+	.flush		= kwest_flush,
+	.fsync		= kwest_fsync,
+	.readlink	= kwest_readlink,
 	.mknod		= kwest_mknod,
+	.create		= kwest_create,
 	.rename		= kwest_rename,
+	.link		= kwest_link,
 	.unlink		= kwest_unlink,
 	.read		= kwest_read,
+	.read_buf	= kwest_read_buf,
 	.write		= kwest_write,
 	.chmod		= kwest_chmod,
 	.chown		= kwest_chown,
 
+/* EXTENDED ATTRIBUTES */
+	.setxattr	= kwest_setxattr,
+	.getxattr	= kwest_getxattr,
+	.listxattr	= kwest_listxattr,
+	.removexattr	= kwest_removexattr,
+
 /* DIRECTORY RELATED FILESYSTEM OPERATIONS */
 	.mkdir		= kwest_mkdir,
 	.rmdir		= kwest_rmdir,
 
 /* NOT IMPLEMENTED */
 /*	.symlink	= kwest_symlink, */
-/*	.readlink	= kwest_readlink, */
-/*	.link		= kwest_link, */
-/*	.utimens	= kwest_utimens, */
-/*	.statfs		= kwest_statfs, */
-/*	.fsync		= kwest_fsync, */
-
-/*
-#ifdef HAVE_SETXATTR
-	.setxattr	= kwest_setxattr,
-	.getxattr	= kwest_getxattr,
-	.listxattr	= kwest_listxattr,
-	.removexattr	= kwest_removexattr,
-#endif
-*/
 };
 
 
+/* __STATISTICS__ */
+
+/* time operation of kwest_oper, counting it as an error if it fails */
+#define STATS_CALL(op, call) \
+	uint64_t start = stats_start(op); \
+	int res = (call); \
+	if(res < 0) { \
+		stats_error(); \
+	} \
+	stats_end(op, start); \
+	return res
+
+static int stats_getattr(const char *path, struct stat *stbuf)
+{
+	STATS_CALL(STATS_GETATTR, kwest_oper.getattr(path, stbuf));
+}
+
+static int stats_opendir(const char *path, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_OPENDIR, kwest_oper.opendir(path, fi));
+}
+
+static int stats_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
+                         off_t offset, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_READDIR,
+	           kwest_oper.readdir(path, buf, filler, offset, fi));
+}
+
+static int stats_releasedir(const char *path, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_RELEASEDIR, kwest_oper.releasedir(path, fi));
+}
+
+static int stats_access(const char *path, int mask)
+{
+	STATS_CALL(STATS_ACCESS, kwest_oper.access(path, mask));
+}
+
+static int stats_truncate(const char *path, off_t size)
+{
+	STATS_CALL(STATS_TRUNCATE, kwest_oper.truncate(path, size));
+}
+
+static int stats_open(const char *path, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_OPEN, kwest_oper.open(path, fi));
+}
+
+static int stats_release(const char *path, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_RELEASE, kwest_oper.release(path, fi));
+}
+
+static int stats_flush(const char *path, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_FLUSH, kwest_oper.flush(path, fi));
+}
+
+static int stats_fsync(const char *path, int datasync,
+                       struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_FSYNC, kwest_oper.fsync(path, datasync, fi));
+}
+
+static int stats_readlink(const char *path, char *buf, size_t size)
+{
+	STATS_CALL(STATS_READLINK, kwest_oper.readlink(path, buf, size));
+}
+
+static int stats_mknod(const char *path, mode_t mode, dev_t rdev)
+{
+	STATS_CALL(STATS_MKNOD, kwest_oper.mknod(path, mode, rdev));
+}
+
+static int stats_create(const char *path, mode_t mode,
+                        struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_CREATE, kwest_oper.create(path, mode, fi));
+}
+
+static int stats_rename(const char *from, const char *to)
+{
+	STATS_CALL(STATS_RENAME, kwest_oper.rename(from, to));
+}
+
+static int stats_link(const char *from, const char *to)
+{
+	STATS_CALL(STATS_LINK, kwest_oper.link(from, to));
+}
+
+static int stats_unlink(const char *path)
+{
+	STATS_CALL(STATS_UNLINK, kwest_oper.unlink(path));
+}
+
+static int stats_read(const char *path, char *buf, size_t size, off_t offset,
+                      struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_READ, kwest_oper.read(path, buf, size, offset, fi));
+}
+
+static int stats_read_buf(const char *path, struct fuse_bufvec **bufp,
+                          size_t size, off_t offset, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_READ,
+	           kwest_oper.read_buf(path, bufp, size, offset, fi));
+}
+
+static int stats_write(const char *path, const char *buf, size_t size,
+                       off_t offset, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_WRITE, kwest_oper.write(path, buf, size, offset, fi));
+}
+
+static int stats_utimens(const char *path, const struct timespec tv[2])
+{
+	STATS_CALL(STATS_UTIMENS, kwest_oper.utimens(path, tv));
+}
+
+static int stats_chmod(const char *path, mode_t mode)
+{
+	STATS_CALL(STATS_CHMOD, kwest_oper.chmod(path, mode));
+}
+
+static int stats_chown(const char *path, uid_t uid, gid_t gid)
+{
+	STATS_CALL(STATS_CHOWN, kwest_oper.chown(path, uid, gid));
+}
+
+static int stats_setxattr(const char *path, const char *name,
+                          const char *value, size_t size, int flags)
+{
+	STATS_CALL(STATS_SETXATTR,
+	           kwest_oper.setxattr(path, name, value, size, flags));
+}
+
+static int stats_getxattr(const char *path, const char *name, char *value,
+                          size_t size)
+{
+	STATS_CALL(STATS_GETXATTR,
+	           kwest_oper.getxattr(path, name, value, size));
+}
+
+static int stats_listxattr(const char *path, char *list, size_t size)
+{
+	STATS_CALL(STATS_LISTXATTR, kwest_oper.listxattr(path, list, size));
+}
+
+static int stats_removexattr(const char *path, const char *name)
+{
+	STATS_CALL(STATS_REMOVEXATTR, kwest_oper.removexattr(path, name));
+}
+
+static int stats_statfs(const char *path, struct statvfs *stbuf)
+{
+	STATS_CALL(STATS_STATFS, kwest_oper.statfs(path, stbuf));
+}
+
+static int stats_mkdir(const char *path, mode_t mode)
+{
+	STATS_CALL(STATS_MKDIR, kwest_oper.mkdir(path, mode));
+}
+
+static int stats_rmdir(const char *path)
+{
+	STATS_CALL(STATS_RMDIR, kwest_oper.rmdir(path));
+}
+
+/**
+ * @struct kwest_stats_oper
+ * @brief operations of kwest_oper, timed for the stats file
+ * @note operations added to kwest_oper need a wrapper here
+ * @see stats.c
+ */
+static struct fuse_operations kwest_stats_oper = {
+	.getattr	= stats_getattr,
+	.opendir	= stats_opendir,
+	.readdir	= stats_readdir,
+	.releasedir	= stats_releasedir,
+	.access		= stats_access,
+	.truncate	= stats_truncate,
+	.utimens	= stats_utimens,
+	.statfs		= stats_statfs,
+	.init		= kwest_init,
+	.destroy	= kwest_destroy,
+	.open		= stats_open,
+	.release	= stats_release,
+	.flush		= stats_flush,
+	.fsync		= stats_fsync,
+	.readlink	= stats_readlink,
+	.mknod		= stats_mknod,
+	.create		= stats_create,
+	.rename		= stats_rename,
+	.link		= stats_link,
+	.unlink		= stats_unlink,
+	.read		= stats_read,
+	.read_buf	= stats_read_buf,
+	.write		= stats_write,
+	.chmod		= stats_chmod,
+	.chown		= stats_chown,
+	.setxattr	= stats_setxattr,
+	.getxattr	= stats_getxattr,
+	.listxattr	= stats_listxattr,
+	.removexattr	= stats_removexattr,
+	.mkdir		= stats_mkdir,
+	.rmdir		= stats_rmdir,
+};
+
+
+/**
+ * @var kwest_opts
+ * @brief kwest specific mount options
+ * @see fuseopts.h
+ */
+static const struct fuse_opt kwest_opts[] = {
+	KWEST_FUSE_OPTS,
+	FUSE_OPT_END
+};
+
 /**
  * @fn int call_fuse_daemon(int argc, char **argv)
  * @brief pass control to fuse daemon
+ * @details kwest options are taken out of the arguments before passing them
+ * to fuse. The high level api cannot set timeouts per entry, so the smallest
+ * timeouts over tags, files and suggestions are given to fuse
  * @param argc argument count from main
  * @param argv argument values from main
  * @return 0 on SUCCESS
@@ -1008,5 +2232,21 @@ static struct fuse_operations kwest_oper = {
  */
 int call_fuse_daemon(int argc, char **argv)
 {
-	return(fuse_main(argc, argv, &kwest_oper, NULL));
+	struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
+	struct kwest_timeouts t;
+	char timeouts[QUERY_SIZE];
+	int ret;
+
+	if(fuse_opt_parse(&args, get_kwest_options(), kwest_opts, NULL) == -1) {
+		return -EINVAL;
+	}
+
+	kwest_min_timeouts(&t);
+	sprintf(timeouts, "-oentry_timeout=%g,attr_timeout=%g,"
+	        "negative_timeout=%g", t.entry, t.attr, t.negative);
+	fuse_opt_add_arg(&args, timeouts);
+
+	ret = fuse_main(args.argc, args.argv, &kwest_stats_oper, NULL);
+	fuse_opt_free_args(&args);
+	return ret;
 }
@@ -0,0 +1,2753 @@
+/**
+ * @file fusell.c
+ * @brief fuse functions implemented on the fuse low level api
+ * @details alternate frontend to fusefunc.c, built into kwest_ll. Operations
+ * address tags and files by inode numbers derived from their tno and fno,
+ * so the cost of an operation does not depend on the depth of the path it
+ * was reached through.
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define FUSE_USE_VERSION 34
+#define _GNU_SOURCE /* copy_file_range */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <fuse_lowlevel.h>
+#include <liburing.h>
+
+#include "fusefunc.h"
+#include "dbfuse.h"
+#include "fusecache.h"
+#include "fuseopts.h"
+#include "fusectl.h"
+#include "stats.h"
+#include "dbinit.h"
+#include "dbbasic.h"
+#include "dbkey.h"
+#include "dbusage.h"
+#include "ingest.h"
+#include "logging.h"
+#include "flags.h"
+#include "magicstrings.h"
+
+
+/* INODE NUMBERS
+ * root tag is FUSE_ROOT_ID, other tags and files are interleaved after it;
+ * ids are given out again, entries carry get_tag_generation and
+ * get_file_generation to tell their holders apart
+ */
+#define KW_INO_TAG(tno)     (((fuse_ino_t)(tno) << 1) + 2)
+#define KW_INO_FILE(fno)    (((fuse_ino_t)(fno) << 1) + 3)
+#define KW_INO_IS_FILE(ino) ((((ino) - 2) & 1) == 1)
+#define KW_INO_ID(ino)      ((int)(((ino) - 2) >> 1))
+
+/* control files and their directory, above inodes of tags and files */
+#define KW_INO_STATS        (~(fuse_ino_t)0 - 3)
+#define KW_INO_CTL_DIR      (~(fuse_ino_t)0 - 2)
+#define KW_INO_CTL          (~(fuse_ino_t)0 - 1)
+#define KW_INO_IS_CTL(ino)  ((ino) >= KW_INO_STATS)
+
+/* buckets of files under tags split by the shard option, tag id in high
+ * bits and bucket in low bits, between inodes of tags and control files
+ */
+#define KW_INO_SHARD(tno, k)  (((fuse_ino_t)1 << 62) | \
+                               ((fuse_ino_t)(tno) << 32) | (uint32_t)(k))
+#define KW_INO_IS_SHARD(ino)  (((ino) >> 62) == 1)
+#define KW_INO_SHARD_TNO(ino) ((int)(((ino) >> 32) & 0x3fffffff))
+#define KW_INO_SHARD_K(ino)   ((int)((ino) & 0xffffffff))
+#define KW_SHARD_NAME         "@%d-%d" /* first and last file id of bucket */
+
+/* FILE HANDLES
+ * backing descriptor in low bits, passthrough backing id in high bits
+ */
+#define KW_FH(fd, backing_id) \
+	(((uint64_t)(backing_id) << 32) | (uint32_t)(fd))
+#define KW_FH_FD(fh)          ((int)((fh) & 0xffffffff))
+#define KW_FH_BACKING(fh)     ((int)((fh) >> 32))
+
+/* DIRECTORY HANDLES
+ * tag id in low bits, flag set if its files are listed in buckets
+ */
+#define KW_DH_SHARDED         ((uint64_t)1 << 32)
+#define KW_DH_TNO(fh)         ((int)((fh) & 0xffffffff))
+
+#define LL_REFS_BUCKETS 4096 /* number of hash chains for lookup counts */
+
+#define LL_READS_MAX 4096 /* reads of backing files in flight at most */
+
+/* parameter of fuse module, Y if it carries requests over io_uring */
+#define LL_URING_PARAM "/sys/module/fuse/parameters/enable_uring"
+
+static int root_tno = SYSTEM_TAG_START; /* tno of TAG_ROOT, set in init */
+static int ll_passthrough = 0; /* kernel accepted passthrough in init */
+static int ll_writeback = 0;   /* kernel caches writes, accepted in init */
+static struct fuse_session *ll_se = NULL; /* session being served */
+
+
+/* __INODE NUMBERS__ */
+
+/**
+ * @fn static fuse_ino_t tag_ino(int tno)
+ * @brief inode number of tag
+ * @param tno tag id
+ * @return inode number
+ * @author Harshvardhan Pandit
+ */
+static fuse_ino_t tag_ino(int tno)
+{
+	return (tno == root_tno) ? FUSE_ROOT_ID : KW_INO_TAG(tno);
+}
+
+/**
+ * @fn static int ino_tno(fuse_ino_t ino)
+ * @brief tag id of inode
+ * @details entries are made in a bucket as in the tag it is part of
+ * @param ino inode number
+ * @return tno on SUCCESS
+ * @return KW_FAIL if inode is not a tag or bucket of a tag
+ * @author Harshvardhan Pandit
+ */
+static int ino_tno(fuse_ino_t ino)
+{
+	if(ino == FUSE_ROOT_ID) {
+		return root_tno;
+	}
+	if(KW_INO_IS_SHARD(ino)) {
+		return KW_INO_SHARD_TNO(ino);
+	}
+	if(KW_INO_IS_CTL(ino) || KW_INO_IS_FILE(ino)) {
+		return KW_FAIL;
+	}
+	return KW_INO_ID(ino);
+}
+
+/**
+ * @fn static int ino_fno(fuse_ino_t ino)
+ * @brief file id of inode
+ * @param ino inode number
+ * @return fno on SUCCESS
+ * @return KW_FAIL if inode is not a file
+ * @author Harshvardhan Pandit
+ */
+static int ino_fno(fuse_ino_t ino)
+{
+	if(ino == FUSE_ROOT_ID || KW_INO_IS_CTL(ino) || KW_INO_IS_SHARD(ino) ||
+	   !KW_INO_IS_FILE(ino)) {
+		return KW_FAIL;
+	}
+	return KW_INO_ID(ino);
+}
+
+/**
+ * @fn static int reply_err(fuse_req_t req, int err)
+ * @brief reply with error, counted for the stats file
+ * @param req request being served
+ * @param err errno, 0 for success
+ * @return result of fuse_reply_err
+ * @author Harshvardhan Pandit
+ */
+static int reply_err(fuse_req_t req, int err)
+{
+	if(err != 0) {
+		stats_error();
+	}
+	return fuse_reply_err(req, err);
+}
+
+
+/* __LOOKUP COUNTS__ */
+
+/**
+ * @struct ll_ref
+ * @brief number of lookups of an inode the kernel has not yet forgotten
+ */
+struct ll_ref {
+	fuse_ino_t ino;
+	uint64_t nlookup;
+	struct ll_ref *next;
+};
+
+static struct ll_ref *ll_refs[LL_REFS_BUCKETS];
+static pthread_mutex_t ll_refs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @fn static void ll_ref_get(fuse_ino_t ino)
+ * @brief count a lookup of inode replied to the kernel
+ * @param ino inode number
+ * @return void
+ * @author Harshvardhan Pandit
+ */
+static void ll_ref_get(fuse_ino_t ino)
+{
+	struct ll_ref *ref;
+	struct ll_ref **head = &ll_refs[ino % LL_REFS_BUCKETS];
+
+	pthread_mutex_lock(&ll_refs_lock);
+	for(ref = *head; ref != NULL; ref = ref->next) {
+		if(ref->ino == ino) {
+			ref->nlookup++;
+			pthread_mutex_unlock(&ll_refs_lock);
+			return;
+		}
+	}
+	ref = malloc(sizeof(struct ll_ref));
+	if(ref != NULL) {
+		ref->ino = ino;
+		ref->nlookup = 1;
+		ref->next = *head;
+		*head = ref;
+	}
+	pthread_mutex_unlock(&ll_refs_lock);
+}
+
+/**
+ * @fn static void ll_ref_put(fuse_ino_t ino, uint64_t nlookup)
+ * @brief drop lookups of inode forgotten by the kernel
+ * @param ino inode number
+ * @param nlookup number of lookups forgotten
+ * @return void
+ * @author Harshvardhan Pandit
+ */
+static void ll_ref_put(fuse_ino_t ino, uint64_t nlookup)
+{
+	struct ll_ref *ref;
+	struct ll_ref **link = &ll_refs[ino % LL_REFS_BUCKETS];
+
+	pthread_mutex_lock(&ll_refs_lock);
+	while((ref = *link) != NULL) {
+		if(ref->ino == ino) {
+			if(ref->nlookup <= nlookup) {
+				*link = ref->next;
+				free(ref);
+			} else {
+				ref->nlookup -= nlookup;
+			}
+			break;
+		}
+		link = &ref->next;
+	}
+	pthread_mutex_unlock(&ll_refs_lock);
+}
+
+
+/**
+ * @fn static bool ll_ref_known(fuse_ino_t ino)
+ * @brief check if kernel holds lookups of inode
+ * @param ino inode number
+ * @return true if inode is known to the kernel
+ * @author Harshvardhan Pandit
+ */
+static bool ll_ref_known(fuse_ino_t ino)
+{
+	struct ll_ref *ref;
+	bool known = false;
+
+	if(ino == FUSE_ROOT_ID) {
+		return true;
+	}
+	pthread_mutex_lock(&ll_refs_lock);
+	for(ref = ll_refs[ino % LL_REFS_BUCKETS]; ref != NULL; ref = ref->next) {
+		if(ref->ino == ino) {
+			known = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&ll_refs_lock);
+	return known;
+}
+
+
+/* __KERNEL CACHE INVALIDATION__ */
+
+/**
+ * @struct ll_notify
+ * @brief name under tag the kernel may hold a stale entry for
+ */
+struct ll_notify {
+	fuse_ino_t parent;
+	char *name;
+	struct ll_notify *next;
+};
+
+static struct ll_notify *notify_head = NULL;
+static struct ll_notify **notify_tail = &notify_head;
+static pthread_mutex_t notify_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t notify_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t notify_thread;
+static bool notify_running = false;
+
+/**
+ * @fn static void *ll_notify_loop(void *arg)
+ * @brief send queued invalidations to the kernel
+ * @details runs on its own thread, as the kernel may need locks held by
+ * the operation that changed the catalog to handle an invalidation
+ * @param arg unused
+ * @return NULL
+ * @author Harshvardhan Pandit
+ */
+static void *ll_notify_loop(void *arg)
+{
+	struct ll_notify *n;
+	(void)arg;
+
+	pthread_mutex_lock(&notify_lock);
+	while(1) {
+		while(notify_head == NULL && notify_running) {
+			pthread_cond_wait(&notify_cond, &notify_lock);
+		}
+		if(notify_head == NULL) {
+			break;
+		}
+		n = notify_head;
+		notify_head = n->next;
+		if(notify_head == NULL) {
+			notify_tail = &notify_head;
+		}
+		pthread_mutex_unlock(&notify_lock);
+
+		fuse_lowlevel_notify_inval_entry(ll_se, n->parent, n->name,
+		                                 strlen(n->name));
+		fuse_lowlevel_notify_inval_inode(ll_se, n->parent, 0, 0);
+		free(n->name);
+		free(n);
+
+		pthread_mutex_lock(&notify_lock);
+	}
+	pthread_mutex_unlock(&notify_lock);
+	return NULL;
+}
+
+/**
+ * @fn static void ll_notify_queue(fuse_ino_t parent, const char *name)
+ * @brief queue invalidation of name under directory
+ * @details only directories known to the kernel are invalidated, others
+ * have nothing cached
+ * @param parent inode of tag or bucket
+ * @param name name of entry
+ * @return void
+ * @author Harshvardhan Pandit
+ */
+static void ll_notify_queue(fuse_ino_t parent, const char *name)
+{
+	struct ll_notify *n;
+
+	if(!ll_ref_known(parent)) {
+		return;
+	}
+	n = malloc(sizeof(struct ll_notify));
+	if(n == NULL) {
+		return;
+	}
+	n->parent = parent;
+	n->name = strdup(name);
+	n->next = NULL;
+
+	pthread_mutex_lock(&notify_lock);
+	if(notify_running && n->name != NULL) {
+		*notify_tail = n;
+		notify_tail = &n->next;
+		pthread_cond_signal(&notify_cond);
+		n = NULL;
+	}
+	pthread_mutex_unlock(&notify_lock);
+
+	if(n != NULL) {
+		free(n->name);
+		free(n);
+	}
+}
+
+/**
+ * @fn static void ll_entry_changed(int tno, int fno, const char *name)
+ * @brief queue invalidation of name under tag
+ * @details a file under a tag split by the shard option is also
+ * invalidated in its bucket, as is the bucket under the tag
+ * @param tno tag id
+ * @param fno file id, KW_FAIL for a tag
+ * @param name name of tag or file
+ * @return void
+ * @see catalog_listener
+ * @author Harshvardhan Pandit
+ */
+static void ll_entry_changed(int tno, int fno, const char *name)
+{
+	char bucket[QUERY_SIZE];
+	int shard = get_kwest_options()->shard;
+
+	if(tno == KW_FAIL) {
+		return;
+	}
+	ll_notify_queue(tag_ino(tno), name);
+	if(shard > 0 && fno != KW_FAIL) {
+		ll_notify_queue(KW_INO_SHARD(tno, fno / shard), name);
+		snprintf(bucket, QUERY_SIZE, KW_SHARD_NAME,
+		         fno / shard * shard, fno / shard * shard + shard - 1);
+		ll_notify_queue(tag_ino(tno), bucket);
+	}
+}
+
+static const struct catalog_listener ll_listener = {
+	.entry_changed = ll_entry_changed,
+};
+
+/**
+ * @fn static void ll_notify_start(void)
+ * @brief start sending catalog changes to the kernel
+ * @return void
+ * @author Harshvardhan Pandit
+ */
+static void ll_notify_start(void)
+{
+	notify_running = true;
+	if(pthread_create(&notify_thread, NULL, ll_notify_loop, NULL) != 0) {
+		notify_running = false;
+		log_msg("ll init: kernel cache invalidation off");
+		return;
+	}
+	set_catalog_listener(&ll_listener);
+}
+
+/**
+ * @fn static void ll_notify_stop(void)
+ * @brief stop sending catalog changes, after sending those queued
+ * @return void
+ * @author Harshvardhan Pandit
+ */
+static void ll_notify_stop(void)
+{
+	if(!notify_running) {
+		return;
+	}
+	set_catalog_listener(NULL);
+	pthread_mutex_lock(&notify_lock);
+	notify_running = false;
+	pthread_cond_signal(&notify_cond);
+	pthread_mutex_unlock(&notify_lock);
+	pthread_join(notify_thread, NULL);
+}
+
+
+/* __ASYNCHRONOUS READS__ */
+
+/**
+ * @struct ll_read
+ * @brief read of backing file submitted to the ring, till it completes
+ */
+struct ll_read {
+	fuse_req_t req;
+	char *buf;
+	uint64_t start; /* time submitted, for stats of reads */
+};
+
+static struct io_uring read_ring;
+static pthread_mutex_t read_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t read_thread;
+static int read_depth = 0;    /* reads in flight at most */
+static int read_inflight = 0; /* reads submitted and not completed */
+static bool read_running = false;
+static __thread bool read_deferred = false; /* set when read is submitted */
+
+/**
+ * @fn static void ll_read_reply(fuse_req_t req, int fd, size_t size,
+ *                               off_t off)
+ * @brief reply to read with data of backing file
+ * @details data is spliced from the backing file when the kernel allows
+ * it, otherwise read into a buffer by libfuse
+ * @param req request of read
+ * @param fd descriptor of backing file
+ * @param size bytes to read
+ * @param off offset of read
+ * @return void
+ * @author Harshvardhan Pandit
+ */
+static void ll_read_reply(fuse_req_t req, int fd, size_t size, off_t off)
+{
+	struct fuse_bufvec buf = FUSE_BUFVEC_INIT(size);
+
+	buf.buf[0].flags = FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK;
+	buf.buf[0].fd = fd;
+	buf.buf[0].pos = off;
+
+	fuse_reply_data(req, &buf, FUSE_BUF_SPLICE_MOVE);
+}
+
+/**
+ * @fn static void *ll_read_loop(void *arg)
+ * @brief reply to reads as they complete, till stopped
+ * @details the kernel holds the file open till its reads are replied to,
+ * so the descriptor of a read in flight is not closed under it. Reads are
+ * timed here from being submitted till replied to, as their latency is
+ * not seen by stats_read.
+ * @param arg unused
+ * @return NULL
+ * @author Harshvardhan Pandit
+ */
+static void *ll_read_loop(void *arg)
+{
+	struct io_uring_cqe *cqe;
+	struct ll_read *r;
+	int res;
+	(void)arg;
+
+	while(1) {
+		res = io_uring_wait_cqe(&read_ring, &cqe);
+		if(res == -EINTR) {
+			continue;
+		} else if(res < 0) {
+			log_msg("ll read: ring failed, %s", strerror(-res));
+			break;
+		}
+		r = io_uring_cqe_get_data(cqe);
+		res = cqe->res;
+		io_uring_cqe_seen(&read_ring, cqe);
+		if(r == NULL) { /* stop, after reads before it completed */
+			break;
+		}
+
+		if(res < 0) {
+			fuse_reply_err(r->req, -res);
+		} else {
+			fuse_reply_buf(r->req, r->buf, res);
+		}
+		stats_end(STATS_READ, r->start);
+		free(r->buf);
+		free(r);
+
+		pthread_mutex_lock(&read_lock);
+		read_inflight--;
+		pthread_mutex_unlock(&read_lock);
+	}
+	return NULL;
+}
+
+/**
+ * @fn static bool ll_read_submit(fuse_req_t req, int fd, size_t size,
+ *                                off_t off)
+ * @brief submit read to the ring, to be replied to once it completes
+ * @details the worker serving the read goes back to serve other requests
+ * at once; once read_depth reads are in flight, the caller reads itself,
+ * so that workers slow down with the disk instead of reads piling up
+ * @param req request of read
+ * @param fd descriptor of backing file
+ * @param size bytes to read
+ * @param off offset of read
+ * @return true if submitted, false if it is to be replied to by the caller
+ * @author Harshvardhan Pandit
+ */
+static bool ll_read_submit(fuse_req_t req, int fd, size_t size, off_t off)
+{
+	struct io_uring_sqe *sqe = NULL;
+	struct ll_read *r;
+
+	if(!read_running) {
+		return false;
+	}
+	r = malloc(sizeof(struct ll_read));
+	if(r == NULL) {
+		return false;
+	}
+	r->buf = malloc(size);
+	if(r->buf == NULL) {
+		free(r);
+		return false;
+	}
+	r->req = req;
+	r->start = stats_now();
+
+	pthread_mutex_lock(&read_lock);
+	if(read_running && read_inflight < read_depth) {
+		sqe = io_uring_get_sqe(&read_ring);
+	}
+	if(sqe != NULL) {
+		io_uring_prep_read(sqe, fd, r->buf, size, off);
+		io_uring_sqe_set_data(sqe, r);
+		if(io_uring_submit(&read_ring) == 1) {
+			read_inflight++;
+			r = NULL;
+		}
+	}
+	pthread_mutex_unlock(&read_lock);
+
+	if(r != NULL) {
+		free(r->buf);
+		free(r);
+		return false;
+	}
+	read_deferred = true;
+	return true;
+}
+
+/**
+ * @fn static void ll_read_start(void)
+ * @brief start ring for reads, of depth given by the async_reads option
+ * @details a read waiting on a slow disk then holds an entry of the ring
+ * instead of a worker of the session, so that one thread keeps as many
+ * reads in flight as the ring holds while workers serve other requests
+ * @return void
+ * @author Harshvardhan Pandit
+ */
+static void ll_read_start(void)
+{
+	int n = get_kwest_options()->async_reads;
+	int res;
+
+	if(n <= 0) {
+		return;
+	}
+	if(n > LL_READS_MAX) {
+		n = LL_READS_MAX;
+	}
+	res = io_uring_queue_init(n, &read_ring, 0);
+	if(res < 0) {
+		log_msg("ll init: no ring for reads, %s", strerror(-res));
+		return;
+	}
+	if(pthread_create(&read_thread, NULL, ll_read_loop, NULL) != 0) {
+		io_uring_queue_exit(&read_ring);
+		return;
+	}
+	read_depth = n;
+	read_running = true;
+	log_msg("ll init: %d reads in flight at most", read_depth);
+}
+
+/**
+ * @fn static void ll_read_stop(void)
+ * @brief stop ring for reads, after replying to reads in flight
+ * @details a no-op drained behind reads in flight tells ll_read_loop
+ * that they all completed
+ * @return void
+ * @author Harshvardhan Pandit
+ */
+static void ll_read_stop(void)
+{
+	struct io_uring_sqe *sqe;
+
+	if(!read_running) {
+		return;
+	}
+	pthread_mutex_lock(&read_lock);
+	read_running = false;
+	while((sqe = io_uring_get_sqe(&read_ring)) == NULL) {
+		io_uring_submit(&read_ring); /* ring full, make room */
+	}
+	io_uring_prep_nop(sqe);
+	io_uring_sqe_set_data(sqe, NULL);
+	io_uring_sqe_set_flags(sqe, IOSQE_IO_DRAIN);
+	io_uring_submit(&read_ring);
+	pthread_mutex_unlock(&read_lock);
+
+	pthread_join(read_thread, NULL);
+	io_uring_queue_exit(&read_ring);
+}
+
+
+/* __SHARDED TAGS__ */
+
+/**
+ * @fn static bool tag_is_sharded(int tno)
+ * @brief check if files of tag are listed in buckets
+ * @details tags with more files than the shard option are split into
+ * buckets of that many file ids, each listed by one range of the index
+ * @param tno tag id
+ * @return true if tag is split
+ * @see tag_has_more_files
+ * @author Harshvardhan Pandit
+ */
+static bool tag_is_sharded(int tno)
+{
+	int shard = get_kwest_options()->shard;
+
+	return shard > 0 && tag_has_more_files(tno, shard);
+}
+
+/**
+ * @fn static int shard_of_name(const char *name)
+ * @brief bucket named by name
+ * @param name name of entry
+ * @return bucket on SUCCESS
+ * @return KW_FAIL if name is not that of a bucket
+ * @author Harshvardhan Pandit
+ */
+static int shard_of_name(const char *name)
+{
+	int shard = get_kwest_options()->shard;
+	int first, last, len = 0;
+
+	if(shard <= 0 || sscanf(name, KW_SHARD_NAME "%n", &first, &last,
+	                        &len) != 2 || name[len] != '\0') {
+		return KW_FAIL;
+	}
+	if(first < 0 || first % shard != 0 || last != first + shard - 1) {
+		return KW_FAIL;
+	}
+	return first / shard;
+}
+
+/**
+ * @fn static void shard_range(int k, int *first, int *last)
+ * @brief ids of files in bucket
+ * @param k bucket
+ * @param first set to first file id
+ * @param last set to last file id
+ * @return void
+ * @author Harshvardhan Pandit
+ */
+static void shard_range(int k, int *first, int *last)
+{
+	long long shard = get_kwest_options()->shard;
+
+	*first = (int)(k * shard);
+	*last = (k * shard + shard - 1 > INT_MAX) ? INT_MAX :
+	                                            (int)(k * shard + shard - 1);
+}
+
+
+/* __ATTRIBUTES__ */
+
+/**
+ * @fn static void fill_tag_attr(int tno, struct stat *st)
+ * @brief attributes of a tag
+ * @param tno tag id
+ * @param st stat buffer to fill
+ * @return void
+ * @author Harshvardhan Pandit
+ */
+static void fill_tag_attr(int tno, struct stat *st)
+{
+	memset(st, 0, sizeof(struct stat));
+	st->st_ino = tag_ino(tno);
+	st->st_mode = S_IFDIR | KW_STDIR;
+	st->st_nlink = 1;
+	st->st_uid = getuid();
+	st->st_gid = getgid();
+}
+
+/**
+ * @fn static void fill_shard_attr(fuse_ino_t ino, struct stat *st)
+ * @brief attributes of a bucket of files
+ * @param ino inode of bucket
+ * @param st stat buffer to fill
+ * @return void
+ * @author Harshvardhan Pandit
+ */
+static void fill_shard_attr(fuse_ino_t ino, struct stat *st)
+{
+	memset(st, 0, sizeof(struct stat));
+	st->st_ino = ino;
+	st->st_mode = S_IFDIR | KW_STDIR;
+	st->st_nlink = 1;
+	st->st_uid = getuid();
+	st->st_gid = getgid();
+}
+
+/**
+ * @fn static void fill_control_attr(fuse_ino_t ino, struct stat *st)
+ * @brief attributes of control files or their directory
+ * @details the directory can be looked up but not listed, the control
+ * file can only be written and the stats file only read
+ * @param ino KW_INO_CTL, KW_INO_STATS or KW_INO_CTL_DIR
+ * @param st stat buffer to fill
+ * @return void
+ * @see fusectl.c
+ * @author Harshvardhan Pandit
+ */
+static void fill_control_attr(fuse_ino_t ino, struct stat *st)
+{
+	memset(st, 0, sizeof(struct stat));
+	st->st_ino = ino;
+	if(ino == KW_INO_CTL) {
+		st->st_mode = S_IFREG | KW_STCTL;
+	} else if(ino == KW_INO_STATS) {
+		st->st_mode = S_IFREG | KW_STSTATS;
+	} else {
+		st->st_mode = S_IFDIR | KW_STCTLDIR;
+	}
+	st->st_nlink = 1;
+	st->st_uid = getuid();
+	st->st_gid = getgid();
+}
+
+/**
+ * @fn static int lookup_control(fuse_ino_t parent, const char *name,
+ *                               struct fuse_entry_param *e)
+ * @brief resolve control directory under root, or control files under it
+ * @param parent inode of parent
+ * @param name name of entry
+ * @param e entry to fill
+ * @return 0 on SUCCESS
+ * @return -ENOENT if name is not a control file or their directory
+ * @author Harshvardhan Pandit
+ */
+static int lookup_control(fuse_ino_t parent, const char *name,
+                          struct fuse_entry_param *e)
+{
+	struct kwest_options *o = get_kwest_options();
+
+	memset(e, 0, sizeof(struct fuse_entry_param));
+	if(parent == FUSE_ROOT_ID && strcmp(name, CONTROL_DIR) == 0) {
+		e->ino = KW_INO_CTL_DIR;
+	} else if(parent == KW_INO_CTL_DIR && strcmp(name, CONTROL_FILE) == 0) {
+		e->ino = KW_INO_CTL;
+	} else if(parent == KW_INO_CTL_DIR && strcmp(name, STATS_FILE) == 0) {
+		e->ino = KW_INO_STATS;
+	} else {
+		return -ENOENT;
+	}
+	fill_control_attr(e->ino, &e->attr);
+	e->entry_timeout = o->tag.entry;
+	e->attr_timeout = o->tag.attr;
+	return 0;
+}
+
+/**
+ * @fn static int fill_file_attr(int fno, const char *abspath,
+ *                               struct stat *st)
+ * @brief attributes of a file, taken from its backing file
+ * @details with the symlinks option, files are symlinks to their backing
+ * files, and the backing file is not looked at
+ * @param fno file id
+ * @param abspath path of backing file if known, NULL to look it up
+ * @param st stat buffer to fill
+ * @return 0 on SUCCESS
+ * @return -errno on error
+ * @author Harshvardhan Pandit
+ */
+static int fill_file_attr(int fno, const char *abspath, struct stat *st)
+{
+	char *path = NULL;
+	int res;
+
+	if(get_kwest_options()->symlinks) {
+		if(abspath == NULL) {
+			abspath = path = get_abspath_by_fno(fno);
+		}
+		if(abspath == NULL) {
+			return -ENOENT;
+		}
+		memset(st, 0, sizeof(struct stat));
+		st->st_mode = S_IFLNK | KW_STLNK;
+		st->st_nlink = 1;
+		st->st_size = strlen(abspath);
+		st->st_uid = getuid();
+		st->st_gid = getgid();
+		free(path);
+	} else if(statcache_lookup(fno, st) != KW_SUCCESS) {
+		if(abspath == NULL) {
+			abspath = path = get_abspath_by_fno(fno);
+		}
+		if(abspath == NULL) {
+			return -ENOENT;
+		}
+		res = stat(abspath, st);
+		if(res == -1) {
+			res = -errno;
+			log_msg("STAT ERROR");
+			free(path);
+			return res;
+		}
+		free(path);
+		statcache_insert(fno, st);
+	}
+	st->st_ino = KW_INO_FILE(fno);
+	return 0;
+}
+
+/**
+ * @fn static int lookup_child(int ptno, const char *name,
+ *                             struct fuse_entry_param *e)
+ * @brief resolve name under tag into an entry
+ * @details tags take precedence over files of the same name, and any tag
+ * can be reached from root, as done by check_path_validity. Files of a
+ * tag split into buckets can still be looked up directly under it.
+ * @param ptno tag id of parent
+ * @param name name of tag or file
+ * @param e entry to fill
+ * @return 0 on SUCCESS
+ * @return -errno on error
+ * @author Harshvardhan Pandit
+ */
+static int lookup_child(int ptno, const char *name, struct fuse_entry_param *e)
+{
+	struct kwest_options *o = get_kwest_options();
+	int id, first, last;
+
+	memset(e, 0, sizeof(struct fuse_entry_param));
+
+	/* names no tag or file has are known without querying database */
+	if(!catalog_may_have(name) && shard_of_name(name) == KW_FAIL) {
+		return -ENOENT;
+	}
+
+	if((id = get_tag_id(name)) != KW_FAIL) {
+		if(ptno != root_tno && get_association_id(id, ptno) == KW_FAIL) {
+			return -ENOENT;
+		}
+		e->ino = tag_ino(id);
+		e->generation = get_tag_generation(id);
+		fill_tag_attr(id, &e->attr);
+		e->entry_timeout = o->tag.entry;
+		e->attr_timeout = o->tag.attr;
+		return 0;
+	}
+
+	if((id = shard_of_name(name)) != KW_FAIL) {
+		shard_range(id, &first, &last);
+		first = get_next_fno_by_tno(ptno, first);
+		if(first == KW_FAIL || first > last || !tag_is_sharded(ptno)) {
+			return -ENOENT; /* no files in bucket */
+		}
+		e->ino = KW_INO_SHARD(ptno, id);
+		fill_shard_attr(e->ino, &e->attr);
+		e->entry_timeout = o->tag.entry;
+		e->attr_timeout = o->tag.attr;
+		return 0;
+	}
+
+	if((id = get_file_id(name)) != KW_FAIL && is_file_tagged_id(id, ptno)) {
+		e->ino = KW_INO_FILE(id);
+		e->generation = get_file_generation(id);
+		e->entry_timeout = o->file.entry;
+		e->attr_timeout = o->file.attr;
+		return fill_file_attr(id, NULL, &e->attr);
+	}
+
+	return -ENOENT;
+}
+
+/**
+ * @fn static int lookup_shard_child(fuse_ino_t parent, const char *name,
+ *                                   struct fuse_entry_param *e)
+ * @brief resolve name in bucket of tag into an entry
+ * @param parent inode of bucket
+ * @param name name of file
+ * @param e entry to fill
+ * @return 0 on SUCCESS
+ * @return -errno on error
+ * @author Harshvardhan Pandit
+ */
+static int lookup_shard_child(fuse_ino_t parent, const char *name,
+                              struct fuse_entry_param *e)
+{
+	struct kwest_options *o = get_kwest_options();
+	int tno = KW_INO_SHARD_TNO(parent);
+	int fno = catalog_may_have(name) ? get_file_id(name) : KW_FAIL;
+	int first, last;
+
+	memset(e, 0, sizeof(struct fuse_entry_param));
+	shard_range(KW_INO_SHARD_K(parent), &first, &last);
+	if(fno == KW_FAIL || fno < first || fno > last ||
+	   !is_file_tagged_id(fno, tno)) {
+		return -ENOENT;
+	}
+	e->ino = KW_INO_FILE(fno);
+	e->generation = get_file_generation(fno);
+	e->entry_timeout = o->file.entry;
+	e->attr_timeout = o->file.attr;
+	return fill_file_attr(fno, NULL, &e->attr);
+}
+
+/**
+ * @fn static int make_vpath(char *path, int ptno, const char *name)
+ * @brief build /parent/name path understood by dbfuse functions
+ * @param path buffer of QUERY_SIZE to hold path
+ * @param ptno tag id of parent
+ * @param name name of entry
+ * @return KW_SUCCESS on SUCCESS
+ * @return KW_FAIL if parent does not exist or path is too long
+ * @author Harshvardhan Pandit
+ */
+static int make_vpath(char *path, int ptno, const char *name)
+{
+	const char *parent = get_tag_name(ptno);
+	int len;
+
+	if(parent == NULL) {
+		return KW_FAIL;
+	}
+	len = snprintf(path, QUERY_SIZE, "/%s/%s", parent, name);
+	free((char *)parent);
+
+	return (len < QUERY_SIZE) ? KW_SUCCESS : KW_FAIL;
+}
+
+
+/* __DIRECTORY LISTINGS__ */
+
+/**
+ * @struct ll_dirbuf
+ * @brief reply buffer of a readdir request
+ */
+struct ll_dirbuf {
+	char *p;
+	size_t size;
+	size_t pos;
+};
+
+/**
+ * @fn static int dirbuf_add(fuse_req_t req, struct ll_dirbuf *b,
+ *                           const char *name, fuse_ino_t ino, mode_t mode,
+ *                           off_t nextoff)
+ * @brief append entry to reply buffer
+ * @return KW_SUCCESS on SUCCESS
+ * @return KW_FAIL if entry does not fit
+ * @author Harshvardhan Pandit
+ */
+static int dirbuf_add(fuse_req_t req, struct ll_dirbuf *b, const char *name,
+                      fuse_ino_t ino, mode_t mode, off_t nextoff)
+{
+	struct stat st;
+	size_t len;
+
+	memset(&st, 0, sizeof(st));
+	st.st_ino = ino;
+	st.st_mode = mode;
+	len = fuse_add_direntry(req, b->p + b->pos, b->size - b->pos, name, &st,
+	                        nextoff);
+	if(len > b->size - b->pos) {
+		return KW_FAIL;
+	}
+	b->pos += len;
+	return KW_SUCCESS;
+}
+
+/**
+ * @fn static int dirbuf_add_plus(fuse_req_t req, struct ll_dirbuf *b,
+ *                                const char *name,
+ *                                struct fuse_entry_param *e, off_t nextoff)
+ * @brief append entry with its attributes to reply buffer
+ * @details every entry but . and .. counts as a lookup of its inode
+ * @return KW_SUCCESS on SUCCESS
+ * @return KW_FAIL if entry does not fit
+ * @author Harshvardhan Pandit
+ */
+static int dirbuf_add_plus(fuse_req_t req, struct ll_dirbuf *b,
+                           const char *name, struct fuse_entry_param *e,
+                           off_t nextoff)
+{
+	size_t len;
+
+	len = fuse_add_direntry_plus(req, b->p + b->pos, b->size - b->pos, name,
+	                             e, nextoff);
+	if(len > b->size - b->pos) {
+		return KW_FAIL;
+	}
+	b->pos += len;
+	if(e->ino != 0) {
+		ll_ref_get(e->ino);
+	}
+	return KW_SUCCESS;
+}
+
+
+/* __FUSE LOW LEVEL OPERATIONS__ */
+
+/**
+ * @fn static void kwest_ll_init(void *userdata, struct fuse_conn_info *conn)
+ * @brief initialise filesystem
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_init(void *userdata, struct fuse_conn_info *conn)
+{
+	(void)userdata;
+
+	/* reads are spliced from backing files, see kwest_ll_read */
+	if(conn->capable & FUSE_CAP_SPLICE_WRITE) {
+		conn->want |= FUSE_CAP_SPLICE_WRITE;
+	}
+	if(conn->capable & FUSE_CAP_SPLICE_MOVE) {
+		conn->want |= FUSE_CAP_SPLICE_MOVE;
+	}
+#ifdef FUSE_CAP_CACHE_SYMLINKS
+	/* targets of files shown as symlinks never change, see readlink */
+	if(get_kwest_options()->symlinks &&
+	   (conn->capable & FUSE_CAP_CACHE_SYMLINKS)) {
+		conn->want |= FUSE_CAP_CACHE_SYMLINKS;
+	}
+#endif
+
+	/* small writes are gathered into pages by the kernel, which writes
+	 * them back in large blocks, see open_backing */
+	if(get_kwest_options()->writeback &&
+	   (conn->capable & FUSE_CAP_WRITEBACK_CACHE)) {
+		conn->want |= FUSE_CAP_WRITEBACK_CACHE;
+		ll_writeback = 1;
+	}
+	log_msg("ll init: writeback %s", ll_writeback ? "on" : "off");
+
+#ifdef FUSE_CAP_PASSTHROUGH
+	/* reads and writes go straight to backing files, see kwest_ll_open.
+	 * Writes cached by the kernel are written back through kwest. */
+	if(get_kwest_options()->passthrough && ll_writeback == 0 &&
+	   (conn->capable & FUSE_CAP_PASSTHROUGH)) {
+		conn->want |= FUSE_CAP_PASSTHROUGH;
+		ll_passthrough = 1;
+	}
+#endif
+	log_msg("ll init: passthrough %s", ll_passthrough ? "on" : "off");
+
+	root_tno = get_tag_id(TAG_ROOT);
+	log_msg("ll init: root tag %d", root_tno);
+
+	ll_notify_start();
+	ll_read_start();
+	if(usage_start() != KW_SUCCESS) {
+		log_msg("ll init: uses of files are not written");
+	}
+	if(ingest_start() != KW_SUCCESS) {
+		log_msg("ll init: metadata of written files not extracted");
+	}
+}
+
+/**
+ * @fn static void kwest_ll_destroy(void *userdata)
+ * @brief operations performed while unmount
+ * @see kwest_destroy
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_destroy(void *userdata)
+{
+	(void)userdata;
+	log_msg("filesytem is being unmounted...");
+	ll_notify_stop();
+	ll_read_stop();
+	usage_stop();
+	ingest_stop();
+	close_db();
+	log_close();
+}
+
+/**
+ * @fn static void kwest_ll_lookup(fuse_req_t req, fuse_ino_t parent,
+ *                                 const char *name)
+ * @brief look up entry by name under tag
+ * @details failed lookups are replied as negative entries, cached by the
+ * kernel for the smaller of the tag and file negative timeouts
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_lookup(fuse_req_t req, fuse_ino_t parent,
+                            const char *name)
+{
+	struct kwest_options *o = get_kwest_options();
+	struct fuse_entry_param e;
+	int ptno = ino_tno(parent);
+	int res;
+
+	log_msg("ll lookup: %lu/%s", (unsigned long)parent, name);
+
+	if(parent == KW_INO_CTL_DIR || (parent == FUSE_ROOT_ID &&
+	                                strcmp(name, CONTROL_DIR) == 0)) {
+		res = lookup_control(parent, name, &e);
+	} else if(ptno == KW_FAIL) {
+		reply_err(req, ENOTDIR);
+		return;
+	} else if(KW_INO_IS_SHARD(parent)) {
+		res = lookup_shard_child(parent, name, &e);
+	} else {
+		res = lookup_child(ptno, name, &e);
+	}
+	if(res == -ENOENT) {
+		memset(&e, 0, sizeof(e));
+		e.entry_timeout = (o->tag.negative < o->file.negative) ?
+		                  o->tag.negative : o->file.negative;
+		fuse_reply_entry(req, &e);
+		return;
+	}
+	if(res != 0) {
+		reply_err(req, -res);
+		return;
+	}
+
+	ll_ref_get(e.ino);
+	fuse_reply_entry(req, &e);
+}
+
+/**
+ * @fn static void kwest_ll_forget(fuse_req_t req, fuse_ino_t ino,
+ *                                 uint64_t nlookup)
+ * @brief kernel dropped lookups of inode
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_forget(fuse_req_t req, fuse_ino_t ino, uint64_t nlookup)
+{
+	ll_ref_put(ino, nlookup);
+	fuse_reply_none(req);
+}
+
+/**
+ * @fn static void kwest_ll_forget_multi(fuse_req_t req, size_t count,
+ *                                       struct fuse_forget_data *forgets)
+ * @brief kernel dropped lookups of several inodes
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_forget_multi(fuse_req_t req, size_t count,
+                                  struct fuse_forget_data *forgets)
+{
+	size_t i;
+
+	for(i = 0; i < count; i++) {
+		ll_ref_put(forgets[i].ino, forgets[i].nlookup);
+	}
+	fuse_reply_none(req);
+}
+
+/**
+ * @fn static void kwest_ll_getattr(fuse_req_t req, fuse_ino_t ino,
+ *                                  struct fuse_file_info *fi)
+ * @brief get attributes of inode
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_getattr(fuse_req_t req, fuse_ino_t ino,
+                             struct fuse_file_info *fi)
+{
+	struct kwest_options *o = get_kwest_options();
+	struct stat st;
+	int fno = ino_fno(ino);
+	int res;
+	(void)fi;
+
+	if(KW_INO_IS_CTL(ino)) {
+		fill_control_attr(ino, &st);
+		fuse_reply_attr(req, &st, o->tag.attr);
+		return;
+	}
+	if(KW_INO_IS_SHARD(ino)) {
+		fill_shard_attr(ino, &st);
+		fuse_reply_attr(req, &st, o->tag.attr);
+		return;
+	}
+	if(fno == KW_FAIL) {
+		fill_tag_attr(ino_tno(ino), &st);
+		fuse_reply_attr(req, &st, o->tag.attr);
+		return;
+	}
+
+	res = fill_file_attr(fno, NULL, &st);
+	if(res != 0) {
+		reply_err(req, -res);
+		return;
+	}
+	fuse_reply_attr(req, &st, o->file.attr);
+}
+
+/**
+ * @fn static void kwest_ll_setattr(fuse_req_t req, fuse_ino_t ino,
+ *                   struct stat *attr, int to_set, struct fuse_file_info *fi)
+ * @brief change mode, owner, size or times of backing file
+ * @note attributes of tags, and of files shown as symlinks, cannot be
+ * changed
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr,
+                             int to_set, struct fuse_file_info *fi)
+{
+	struct kwest_options *o = get_kwest_options();
+	struct timespec tv[2];
+	struct stat st;
+	char *abspath = NULL;
+	int fno = ino_fno(ino);
+	int res = 0;
+
+	if(ino == KW_INO_CTL && to_set == FUSE_SET_ATTR_SIZE) {
+		fill_control_attr(ino, &st); /* opened with O_TRUNC */
+		fuse_reply_attr(req, &st, o->tag.attr);
+		return;
+	}
+	if(fno == KW_FAIL || get_kwest_options()->symlinks) {
+		reply_err(req, EPERM); /* symlinks are not changed */
+		return;
+	}
+	abspath = get_abspath_by_fno(fno);
+	if(abspath == NULL) {
+		reply_err(req, ENOENT);
+		return;
+	}
+
+	if((to_set & FUSE_SET_ATTR_MODE) && res == 0) {
+		res = chmod(abspath, attr->st_mode);
+	}
+	if((to_set & (FUSE_SET_ATTR_UID | FUSE_SET_ATTR_GID)) && res == 0) {
+		res = lchown(abspath,
+		       (to_set & FUSE_SET_ATTR_UID) ? attr->st_uid : (uid_t)-1,
+		       (to_set & FUSE_SET_ATTR_GID) ? attr->st_gid : (gid_t)-1);
+	}
+	if((to_set & FUSE_SET_ATTR_SIZE) && res == 0) {
+		res = (fi != NULL) ?
+		      ftruncate(KW_FH_FD(fi->fh), attr->st_size) :
+		      truncate(abspath, attr->st_size);
+		if(res == 0) {
+			count_file_size(fno, attr->st_size);
+			ingest_written(fno);
+		}
+	}
+	if((to_set & (FUSE_SET_ATTR_ATIME | FUSE_SET_ATTR_MTIME)) && res == 0) {
+		tv[0].tv_sec = 0;
+		tv[0].tv_nsec = UTIME_OMIT;
+		tv[1] = tv[0];
+		if(to_set & FUSE_SET_ATTR_ATIME_NOW) {
+			tv[0].tv_nsec = UTIME_NOW;
+		} else if(to_set & FUSE_SET_ATTR_ATIME) {
+			tv[0] = attr->st_atim;
+		}
+		if(to_set & FUSE_SET_ATTR_MTIME_NOW) {
+			tv[1].tv_nsec = UTIME_NOW;
+		} else if(to_set & FUSE_SET_ATTR_MTIME) {
+			tv[1] = attr->st_mtim;
+		}
+		res = utimensat(AT_FDCWD, abspath, tv, 0);
+	}
+	if(res == -1) {
+		res = errno;
+		free(abspath);
+		reply_err(req, res);
+		return;
+	}
+	free(abspath);
+
+	statcache_invalidate(fno);
+	res = fill_file_attr(fno, NULL, &st);
+	if(res != 0) {
+		reply_err(req, -res);
+		return;
+	}
+	fuse_reply_attr(req, &st, o->file.attr);
+}
+
+/**
+ * @fn static void kwest_ll_readlink(fuse_req_t req, fuse_ino_t ino)
+ * @brief read target of file shown as symlink
+ * @details with the symlinks option, files are symlinks to their backing
+ * files, so applications open the backing file directly and its data is
+ * never read or written through kwest
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_readlink(fuse_req_t req, fuse_ino_t ino)
+{
+	char *abspath = NULL;
+	int fno = ino_fno(ino);
+
+	if(fno == KW_FAIL || !get_kwest_options()->symlinks) {
+		reply_err(req, EINVAL);
+		return;
+	}
+	abspath = get_abspath_by_fno(fno);
+	if(abspath == NULL) {
+		reply_err(req, ENOENT);
+		return;
+	}
+	fuse_reply_readlink(req, abspath);
+	free(abspath);
+}
+
+/**
+ * @fn static void kwest_ll_mkdir(fuse_req_t req, fuse_ino_t parent,
+ *                                const char *name, mode_t mode)
+ * @brief make tag under parent tag
+ * @see make_directory
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_mkdir(fuse_req_t req, fuse_ino_t parent, const char *name,
+                           mode_t mode)
+{
+	struct fuse_entry_param e;
+	char path[QUERY_SIZE];
+	int ptno = ino_tno(parent);
+	int res;
+
+	log_msg("ll mkdir: %lu/%s", (unsigned long)parent, name);
+
+	if(ptno == KW_FAIL || make_vpath(path, ptno, name) != KW_SUCCESS) {
+		reply_err(req, ENOENT);
+		return;
+	}
+	/* buckets only hold files, names of virtual tags of kwest are kept */
+	if(KW_INO_IS_SHARD(parent) ||
+	   usage_of_path(strrchr(path, '/')) != KW_FAIL) {
+		reply_err(req, EPERM);
+		return;
+	}
+	if(get_tag_id(name) != KW_FAIL) {
+		reply_err(req, EEXIST);
+		return;
+	}
+	if(make_directory(path, mode) != KW_SUCCESS) {
+		reply_err(req, EIO);
+		return;
+	}
+
+	res = lookup_child(ptno, name, &e);
+	if(res != 0) {
+		reply_err(req, -res);
+		return;
+	}
+	ll_ref_get(e.ino);
+	fuse_reply_entry(req, &e);
+}
+
+/**
+ * @fn static void kwest_ll_rmdir(fuse_req_t req, fuse_ino_t parent,
+ *                                const char *name)
+ * @brief remove tag
+ * @see remove_directory
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_rmdir(fuse_req_t req, fuse_ino_t parent, const char *name)
+{
+	struct fuse_entry_param e;
+	char path[QUERY_SIZE];
+	int ptno = ino_tno(parent);
+
+	log_msg("ll rmdir: %lu/%s", (unsigned long)parent, name);
+
+	if(ptno == KW_FAIL || lookup_child(ptno, name, &e) != 0 ||
+	   make_vpath(path, ptno, name) != KW_SUCCESS) {
+		reply_err(req, ENOENT);
+		return;
+	}
+	if(!S_ISDIR(e.attr.st_mode)) {
+		reply_err(req, ENOTDIR);
+		return;
+	}
+	if(KW_INO_IS_SHARD(e.ino)) {
+		reply_err(req, EPERM);
+		return;
+	}
+
+	reply_err(req, (remove_directory(path) == KW_SUCCESS) ? 0 : EIO);
+}
+
+/**
+ * @fn static void kwest_ll_unlink(fuse_req_t req, fuse_ino_t parent,
+ *                                 const char *name)
+ * @brief untag file from parent tag
+ * @see remove_this_file
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_unlink(fuse_req_t req, fuse_ino_t parent,
+                            const char *name)
+{
+	struct fuse_entry_param e;
+	char path[QUERY_SIZE];
+	int ptno = ino_tno(parent);
+
+	log_msg("ll unlink: %lu/%s", (unsigned long)parent, name);
+
+	if(ptno == KW_FAIL || lookup_child(ptno, name, &e) != 0 ||
+	   make_vpath(path, ptno, name) != KW_SUCCESS) {
+		reply_err(req, ENOENT);
+		return;
+	}
+	if(S_ISDIR(e.attr.st_mode)) {
+		reply_err(req, EISDIR);
+		return;
+	}
+
+	reply_err(req, (remove_this_file(path) == KW_SUCCESS) ? 0 : EIO);
+}
+
+/**
+ * @fn static void kwest_ll_rename(fuse_req_t req, fuse_ino_t parent,
+ *                                 const char *name, fuse_ino_t newparent,
+ *                                 const char *newname, unsigned int flags)
+ * @brief move file from one tag to another
+ * @note file keeps its name, as in kwest_rename
+ * @see retag_file
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_rename(fuse_req_t req, fuse_ino_t parent, const char *name,
+                            fuse_ino_t newparent, const char *newname,
+                            unsigned int flags)
+{
+	struct fuse_entry_param e;
+	const char *tag1 = NULL;
+	const char *tag2 = NULL;
+	int ptno = ino_tno(parent);
+	int nptno = ino_tno(newparent);
+	int res = EIO;
+
+	log_msg("ll rename: %lu/%s to %lu/%s", (unsigned long)parent, name,
+	        (unsigned long)newparent, newname);
+
+	if(flags != 0) {
+		reply_err(req, EINVAL);
+		return;
+	}
+	if(strcmp(name, newname) != 0) {
+		reply_err(req, EPERM);
+		return;
+	}
+	if(ptno == KW_FAIL || nptno == KW_FAIL ||
+	   lookup_child(ptno, name, &e) != 0) {
+		reply_err(req, ENOENT);
+		return;
+	}
+	if(S_ISDIR(e.attr.st_mode)) {
+		reply_err(req, EPERM);
+		return;
+	}
+
+	tag1 = get_tag_name(ptno);
+	tag2 = get_tag_name(nptno);
+	if(tag1 != NULL && tag2 != NULL &&
+	   retag_file(tag1, tag2, name, DBFUSE_MV) == KW_SUCCESS) {
+		res = 0;
+	}
+	free((char *)tag1);
+	free((char *)tag2);
+	reply_err(req, res);
+}
+
+/**
+ * @fn static int open_backing(fuse_req_t req, int fno, int flags,
+ *                             struct fuse_file_info *fi)
+ * @brief open backing file of fno, descriptor is kept in fi->fh
+ * @details with passthrough, the backing file is registered with the
+ * kernel, which then reads and writes it without calling the daemon. If
+ * registering fails, as without CAP_SYS_ADMIN, the file is served by
+ * kwest_ll_read and kwest_ll_write.
+ * @param req request being served
+ * @param fno file id
+ * @param flags open flags used on backing file
+ * @param fi fuse file handle
+ * @return 0 on SUCCESS
+ * @return errno on error
+ * @author Harshvardhan Pandit
+ */
+static int open_backing(fuse_req_t req, int fno, int flags,
+                        struct fuse_file_info *fi)
+{
+	char *abspath = NULL;
+	int backing_id = 0;
+	int fd;
+
+	abspath = get_abspath_by_fno(fno);
+	if(abspath == NULL) {
+		return ENOENT;
+	}
+
+	/* pages written back by the kernel are read in first, and appends
+	 * are placed by the kernel which knows the size of the file */
+	if(ll_writeback) {
+		if((flags & O_ACCMODE) == O_WRONLY) {
+			flags = (flags & ~O_ACCMODE) | O_RDWR;
+		}
+		flags &= ~O_APPEND;
+	}
+
+	fd = open(abspath, flags);
+	free(abspath);
+	if(fd == -1) {
+		return errno;
+	}
+
+#ifdef FUSE_CAP_PASSTHROUGH
+	if(ll_passthrough) {
+		backing_id = fuse_passthrough_open(req, fd);
+		if(backing_id > 0) {
+			fi->backing_id = backing_id;
+		} else {
+			log_msg("ll open: no passthrough for %d", fno);
+			backing_id = 0;
+		}
+	}
+#else
+	(void)req;
+#endif
+
+	if((fi->flags & O_ACCMODE) != O_RDONLY) {
+		ingest_open(fno, fd);
+	}
+	fi->fh = KW_FH(fd, backing_id);
+	return 0;
+}
+
+/**
+ * @fn static void kwest_ll_open(fuse_req_t req, fuse_ino_t ino,
+ *                               struct fuse_file_info *fi)
+ * @brief open backing file
+ * @see open_backing
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_open(fuse_req_t req, fuse_ino_t ino,
+                          struct fuse_file_info *fi)
+{
+	int fno = ino_fno(ino);
+	int res;
+
+	/* control file only takes commands, see fusectl.c */
+	if(ino == KW_INO_CTL) {
+		if((fi->flags & O_ACCMODE) != O_WRONLY) {
+			reply_err(req, EACCES);
+			return;
+		}
+		fi->fh = (uintptr_t)control_open();
+		if(fi->fh == 0) {
+			reply_err(req, ENOMEM);
+			return;
+		}
+		fi->direct_io = 1;
+		fuse_reply_open(req, fi);
+		return;
+	}
+	/* stats file is read from a report made on open, see stats.c */
+	if(ino == KW_INO_STATS) {
+		if((fi->flags & O_ACCMODE) != O_RDONLY) {
+			reply_err(req, EACCES);
+			return;
+		}
+		fi->fh = (uintptr_t)stats_report(NULL);
+		if(fi->fh == 0) {
+			reply_err(req, ENOMEM);
+			return;
+		}
+		fi->direct_io = 1;
+		fuse_reply_open(req, fi);
+		return;
+	}
+	if(fno == KW_FAIL) {
+		reply_err(req, EISDIR);
+		return;
+	}
+	res = open_backing(req, fno, fi->flags, fi);
+	if(res != 0) {
+		reply_err(req, res);
+		return;
+	}
+	usage_open(fno);
+	fuse_reply_open(req, fi);
+}
+
+/**
+ * @fn static int tag_here(int ptno, const char *name,
+ *                         struct fuse_entry_param *e)
+ * @brief tag file of name under tag, as a link made within kwest
+ * @details kwest holds one file per name, so a new entry with the name of
+ * a file is that file under one more tag. Only the catalog changes.
+ * @param ptno tag id of parent
+ * @param name name of file
+ * @param e entry to fill with the file
+ * @return 0 on SUCCESS
+ * @return -EEXIST if name is already under tag
+ * @return -EPERM if name is not a file in kwest
+ * @return -EIO on error
+ * @author Harshvardhan Pandit
+ */
+static int tag_here(int ptno, const char *name, struct fuse_entry_param *e)
+{
+	const char *tag = NULL;
+	int res = -EIO;
+
+	if(lookup_child(ptno, name, e) == 0) {
+		return -EEXIST;
+	}
+	if(get_file_id(name) == KW_FAIL) {
+		log_msg("%s not in kwest", name);
+		return -EPERM;
+	}
+
+	tag = get_tag_name(ptno);
+	if(tag != NULL && tag_file(tag, name) == KW_SUCCESS) {
+		res = lookup_child(ptno, name, e);
+	}
+	free((char *)tag);
+	return res;
+}
+
+/**
+ * @fn static int create_here(int ptno, const char *name, mode_t mode,
+ *                            int flags, struct fuse_entry_param *e)
+ * @brief create new file of name on disk and add it to kwest under tag
+ * @details the file is created in the directory of the parent tag in the
+ * store directory, as by kwest_create for a path of that single tag
+ * @param ptno tag id of parent
+ * @param name name of file
+ * @param mode mode of file
+ * @param flags flags of create
+ * @param e entry to fill with the file
+ * @return 0 on SUCCESS
+ * @return -errno on error
+ * @see create_this_file
+ * @author Harshvardhan Pandit
+ */
+static int create_here(int ptno, const char *name, mode_t mode, int flags,
+                       struct fuse_entry_param *e)
+{
+	const char *tag = NULL;
+	char *path = NULL;
+	int res;
+
+	if(ptno != root_tno) {
+		tag = get_tag_name(ptno);
+		if(tag == NULL) {
+			return -ENOENT;
+		}
+	}
+	if(asprintf(&path, "/%s%s%s", tag ? tag : "", tag ? "/" : "",
+	            name) == -1) {
+		free((char *)tag);
+		return -ENOMEM;
+	}
+	free((char *)tag);
+
+	res = create_this_file(path, mode, flags);
+	free(path);
+	if(res < 0) {
+		return res;
+	}
+	close(res);
+	return lookup_child(ptno, name, e);
+}
+
+/**
+ * @fn static void kwest_ll_create(fuse_req_t req, fuse_ino_t parent,
+ *                                 const char *name, mode_t mode,
+ *                                 struct fuse_file_info *fi)
+ * @brief create file
+ * @details a name not in kwest is a new file, see create_here. A name in
+ * kwest is another file, as the kernel only creates names it did not find
+ * under parent, and its data is never opened for a create. ln or cp -l
+ * tag it under parent, see kwest_ll_link.
+ * @see create_here
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_create(fuse_req_t req, fuse_ino_t parent,
+                            const char *name, mode_t mode,
+                            struct fuse_file_info *fi)
+{
+	struct fuse_entry_param e;
+	int ptno = ino_tno(parent);
+	int res;
+
+	log_msg("ll create: %lu/%s", (unsigned long)parent, name);
+
+	if(ptno == KW_FAIL) {
+		reply_err(req, ENOENT);
+		return;
+	}
+	if(KW_INO_IS_SHARD(parent)) { /* buckets are listings only */
+		reply_err(req, EPERM);
+		return;
+	}
+	if(get_file_id(name) != KW_FAIL) {
+		reply_err(req, EEXIST);
+		return;
+	}
+	res = create_here(ptno, name, mode, fi->flags, &e);
+	if(res != 0) {
+		reply_err(req, -res);
+		return;
+	}
+
+	res = open_backing(req, ino_fno(e.ino),
+	                   fi->flags & ~(O_CREAT | O_EXCL | O_TRUNC), fi);
+	if(res != 0) {
+		reply_err(req, res);
+		return;
+	}
+	ingest_written(ino_fno(e.ino)); /* new files are always extracted */
+	ll_ref_get(e.ino);
+	fuse_reply_create(req, &e, fi);
+}
+
+/**
+ * @fn static void kwest_ll_link(fuse_req_t req, fuse_ino_t ino,
+ *                               fuse_ino_t newparent, const char *newname)
+ * @brief hard link file under another tag
+ * @details the way to have a file under one more tag without copying its
+ * data, as used by ln and cp -l: only the catalog changes
+ * @note link keeps the name of the file, as in kwest_ll_rename
+ * @see tag_here
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_link(fuse_req_t req, fuse_ino_t ino,
+                          fuse_ino_t newparent, const char *newname)
+{
+	struct fuse_entry_param e;
+	const char *name = NULL;
+	int fno = ino_fno(ino);
+	int nptno = ino_tno(newparent);
+	int res;
+
+	log_msg("ll link: %lu to %lu/%s", (unsigned long)ino,
+	        (unsigned long)newparent, newname);
+
+	if(fno == KW_FAIL) {
+		reply_err(req, EPERM);
+		return;
+	}
+	if(nptno == KW_FAIL || (name = get_file_name(fno)) == NULL) {
+		reply_err(req, ENOENT);
+		return;
+	}
+	res = (strcmp(name, newname) == 0) ? tag_here(nptno, name, &e) : -EPERM;
+	free((char *)name);
+	if(res != 0) {
+		reply_err(req, -res);
+		return;
+	}
+	ll_ref_get(e.ino);
+	fuse_reply_entry(req, &e);
+}
+
+/**
+ * @fn static void kwest_ll_read(fuse_req_t req, fuse_ino_t ino, size_t size,
+ *                               off_t off, struct fuse_file_info *fi)
+ * @brief read from backing file
+ * @details the reply names the backing descriptor and offset, so fuse
+ * splices pages of the backing file to the kernel when splice is enabled
+ * in init, and reads the descriptor into its own buffer otherwise. With
+ * the async_reads option the read is submitted to io_uring instead and
+ * replied to from a buffer once it completes, unless the ring is full.
+ * @see ll_read_submit
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_read(fuse_req_t req, fuse_ino_t ino, size_t size,
+                          off_t off, struct fuse_file_info *fi)
+{
+	const char *report;
+	size_t len;
+
+	if(ino == KW_INO_STATS) {
+		report = (const char *)(uintptr_t)fi->fh;
+		len = strlen(report);
+		if((size_t)off >= len) {
+			fuse_reply_buf(req, NULL, 0);
+		} else {
+			fuse_reply_buf(req, report + off,
+			               (size < len - off) ? size : len - off);
+		}
+		return;
+	}
+
+	/* not seen when the kernel reads the backing file directly */
+	usage_read(ino_fno(ino));
+	if(!ll_read_submit(req, KW_FH_FD(fi->fh), size, off)) {
+		ll_read_reply(req, KW_FH_FD(fi->fh), size, off);
+	}
+}
+
+/**
+ * @fn static void kwest_ll_write(fuse_req_t req, fuse_ino_t ino,
+ *                                const char *buf, size_t size, off_t off,
+ *                                struct fuse_file_info *fi)
+ * @brief write to backing file
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
+                           size_t size, off_t off, struct fuse_file_info *fi)
+{
+	ssize_t res;
+
+	if(ino == KW_INO_CTL) {
+		res = control_write((struct kwest_control *)(uintptr_t)fi->fh,
+		                    buf, size);
+		if(res < 0) {
+			reply_err(req, -res);
+		} else {
+			fuse_reply_write(req, res);
+		}
+		return;
+	}
+	res = pwrite(KW_FH_FD(fi->fh), buf, size, off);
+	if(res == -1) {
+		reply_err(req, errno);
+		return;
+	}
+	ingest_written(ino_fno(ino));
+	statcache_invalidate(ino_fno(ino));
+	fuse_reply_write(req, res);
+}
+
+/**
+ * @fn static void kwest_ll_copy_file_range(fuse_req_t req,
+ *          fuse_ino_t ino_in, off_t off_in, struct fuse_file_info *fi_in,
+ *          fuse_ino_t ino_out, off_t off_out, struct fuse_file_info *fi_out,
+ *          size_t len, int flags)
+ * @brief copy range between backing files
+ * @details ranges are copied between backing files by the kernel, without
+ * passing through kwest. Plain cp always copies data: kwest holding one
+ * file per name, cp of a file to another tag fails with EEXIST, and only
+ * ln or cp -l tag the same file there without copying, see kwest_ll_link.
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_copy_file_range(fuse_req_t req, fuse_ino_t ino_in,
+                                     off_t off_in,
+                                     struct fuse_file_info *fi_in,
+                                     fuse_ino_t ino_out, off_t off_out,
+                                     struct fuse_file_info *fi_out,
+                                     size_t len, int flags)
+{
+	ssize_t res;
+
+	if(KW_INO_IS_CTL(ino_in) || KW_INO_IS_CTL(ino_out)) {
+		reply_err(req, EINVAL);
+		return;
+	}
+
+	res = copy_file_range(KW_FH_FD(fi_in->fh), &off_in,
+	                      KW_FH_FD(fi_out->fh), &off_out, len, flags);
+	if(res == -1) {
+		reply_err(req, errno);
+		return;
+	}
+	ingest_written(ino_fno(ino_out));
+	statcache_invalidate(ino_fno(ino_out));
+	fuse_reply_write(req, res);
+}
+
+/**
+ * @fn static void kwest_ll_release(fuse_req_t req, fuse_ino_t ino,
+ *                                  struct fuse_file_info *fi)
+ * @brief close backing file
+ * @details writes through passthrough are not seen by the daemon, so
+ * cached attributes of files opened for writing are dropped here
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_release(fuse_req_t req, fuse_ino_t ino,
+                             struct fuse_file_info *fi)
+{
+	struct stat st;
+
+	if(ino == KW_INO_CTL) {
+		control_release((struct kwest_control *)(uintptr_t)fi->fh);
+		reply_err(req, 0);
+		return;
+	}
+	if(ino == KW_INO_STATS) {
+		free((char *)(uintptr_t)fi->fh);
+		reply_err(req, 0);
+		return;
+	}
+#ifdef FUSE_CAP_PASSTHROUGH
+	if(KW_FH_BACKING(fi->fh) > 0) {
+		fuse_passthrough_close(req, KW_FH_BACKING(fi->fh));
+		if((fi->flags & O_ACCMODE) != O_RDONLY) {
+			statcache_invalidate(ino_fno(ino));
+		}
+	}
+#endif
+	/* metadata of file written is extracted in the background */
+	if((fi->flags & O_ACCMODE) != O_RDONLY) {
+		if(fstat(KW_FH_FD(fi->fh), &st) == 0) {
+			count_file_size(ino_fno(ino), st.st_size);
+		}
+		ingest_close(ino_fno(ino), KW_FH_FD(fi->fh));
+	}
+	reply_err(req, (close(KW_FH_FD(fi->fh)) == -1) ? errno : 0);
+}
+
+/**
+ * @fn static void kwest_ll_flush(fuse_req_t req, fuse_ino_t ino,
+ *                                struct fuse_file_info *fi)
+ * @brief called on each close of a file
+ * @details runs commands written to the control file, so that close
+ * reports whether they were applied
+ * @see control_flush
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_flush(fuse_req_t req, fuse_ino_t ino,
+                           struct fuse_file_info *fi)
+{
+	if(ino == KW_INO_CTL) {
+		reply_err(req, -control_flush(
+		          (struct kwest_control *)(uintptr_t)fi->fh));
+		return;
+	}
+	if(KW_INO_IS_CTL(ino)) {
+		reply_err(req, 0);
+		return;
+	}
+	/* errors of writes held back by the backing file system are
+	 * reported on close of a duplicate, leaving the handle open */
+	reply_err(req, (close(dup(KW_FH_FD(fi->fh))) == -1) ? errno : 0);
+}
+
+/**
+ * @fn static void kwest_ll_fsync(fuse_req_t req, fuse_ino_t ino,
+ *                                int datasync, struct fuse_file_info *fi)
+ * @brief write data of backing file held in memory to disk
+ * @details with writeback, pages cached by the kernel are written back
+ * before fsync is sent, so syncing the backing file makes them durable
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_fsync(fuse_req_t req, fuse_ino_t ino, int datasync,
+                           struct fuse_file_info *fi)
+{
+	int res;
+
+	if(KW_INO_IS_CTL(ino)) {
+		reply_err(req, 0);
+		return;
+	}
+	res = datasync ? fdatasync(KW_FH_FD(fi->fh)) : fsync(KW_FH_FD(fi->fh));
+	reply_err(req, (res == -1) ? errno : 0);
+}
+
+/**
+ * @fn static void kwest_ll_setxattr(fuse_req_t req, fuse_ino_t ino,
+ *                                   const char *name, const char *value,
+ *                                   size_t size, int flags)
+ * @brief set extended attribute
+ * @details writing XATTR_TAGS replaces the tags of the file by the comma
+ * separated tags in value at once, without a rename per tag
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_setxattr(fuse_req_t req, fuse_ino_t ino,
+                              const char *name, const char *value,
+                              size_t size, int flags)
+{
+	int fno = ino_fno(ino);
+
+	log_msg("ll setxattr: %lu %s", (unsigned long)ino, name);
+
+	if(fno == KW_FAIL || strcmp(name, XATTR_TAGS) != 0) {
+		reply_err(req, ENOTSUP);
+		return;
+	}
+	if(flags & XATTR_CREATE) { /* file always has tags */
+		reply_err(req, EEXIST);
+		return;
+	}
+	reply_err(req, -set_tags_xattr(fno, value, size));
+}
+
+/**
+ * @fn static void kwest_ll_getxattr(fuse_req_t req, fuse_ino_t ino,
+ *                                   const char *name, size_t size)
+ * @brief get extended attribute
+ * @details XATTR_TAGS holds the comma separated tags of the file
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_getxattr(fuse_req_t req, fuse_ino_t ino,
+                              const char *name, size_t size)
+{
+	char *value = NULL;
+	int fno = ino_fno(ino);
+	int res;
+
+	if(fno == KW_FAIL || strcmp(name, XATTR_TAGS) != 0) {
+		reply_err(req, ENODATA);
+		return;
+	}
+	if(size == 0) {
+		res = get_tags_xattr(fno, NULL, 0);
+		if(res < 0) {
+			reply_err(req, -res);
+		} else {
+			fuse_reply_xattr(req, res);
+		}
+		return;
+	}
+
+	value = malloc(size);
+	if(value == NULL) {
+		reply_err(req, ENOMEM);
+		return;
+	}
+	res = get_tags_xattr(fno, value, size);
+	if(res < 0) {
+		reply_err(req, -res);
+	} else {
+		fuse_reply_buf(req, value, res);
+	}
+	free(value);
+}
+
+/**
+ * @fn static void kwest_ll_listxattr(fuse_req_t req, fuse_ino_t ino,
+ *                                    size_t size)
+ * @brief list extended attributes, files have XATTR_TAGS only
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_listxattr(fuse_req_t req, fuse_ino_t ino, size_t size)
+{
+	size_t len = (ino_fno(ino) == KW_FAIL) ? 0 : sizeof(XATTR_TAGS);
+
+	if(size == 0) {
+		fuse_reply_xattr(req, len);
+	} else if(size < len) {
+		reply_err(req, ERANGE);
+	} else {
+		fuse_reply_buf(req, XATTR_TAGS, len);
+	}
+}
+
+/**
+ * @fn static void kwest_ll_removexattr(fuse_req_t req, fuse_ino_t ino,
+ *                                      const char *name)
+ * @brief remove extended attribute
+ * @note a file is never without tags, so XATTR_TAGS cannot be removed
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_removexattr(fuse_req_t req, fuse_ino_t ino,
+                                 const char *name)
+{
+	if(ino_fno(ino) == KW_FAIL || strcmp(name, XATTR_TAGS) != 0) {
+		reply_err(req, ENODATA);
+		return;
+	}
+	reply_err(req, EPERM);
+}
+
+/**
+ * @fn static void kwest_ll_opendir(fuse_req_t req, fuse_ino_t ino,
+ *                                  struct fuse_file_info *fi)
+ * @brief open tag or bucket for listing, its tno is held in fi->fh
+ * @details whether a tag is split into buckets is decided once here, so
+ * the listing does not change shape while it is read
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_opendir(fuse_req_t req, fuse_ino_t ino,
+                             struct fuse_file_info *fi)
+{
+	int tno = ino_tno(ino);
+
+	if(ino == KW_INO_CTL_DIR) { /* not listed */
+		reply_err(req, EACCES);
+		return;
+	}
+	if(tno == KW_FAIL) {
+		reply_err(req, ENOTDIR);
+		return;
+	}
+
+	fi->fh = tno;
+	if(!KW_INO_IS_SHARD(ino) && tag_is_sharded(tno)) {
+		fi->fh |= KW_DH_SHARDED;
+	}
+	fuse_reply_open(req, fi);
+}
+
+/**
+ * @fn static int add_dot(fuse_req_t req, struct ll_dirbuf *b,
+ *                        const char *name, fuse_ino_t ino, off_t nextoff,
+ *                        int plus)
+ * @brief append . or .. to reply buffer
+ * @return KW_SUCCESS on SUCCESS
+ * @return KW_FAIL if entry does not fit
+ * @author Harshvardhan Pandit
+ */
+static int add_dot(fuse_req_t req, struct ll_dirbuf *b, const char *name,
+                   fuse_ino_t ino, off_t nextoff, int plus)
+{
+	struct fuse_entry_param e;
+
+	if(!plus) {
+		return dirbuf_add(req, b, name, ino, S_IFDIR, nextoff);
+	}
+	/* not looked up by the kernel, only inode and type are used */
+	memset(&e, 0, sizeof(e));
+	e.attr.st_ino = ino;
+	e.attr.st_mode = S_IFDIR;
+	return dirbuf_add_plus(req, b, name, &e, nextoff);
+}
+
+/**
+ * @fn static void ll_readdir(fuse_req_t req, fuse_ino_t ino, size_t size,
+ *                            off_t off, struct fuse_file_info *fi, int plus)
+ * @brief reply entries of tag starting at offset
+ * @details offsets name the part of the listing and the id following the
+ * last entry returned, so each request runs one query from that id on
+ * and stops once the reply buffer is full. With plus, entries carry their
+ * attributes: files are listed with the path of their backing file by the
+ * same query, and stat through the attribute cache, so no getattr or
+ * lookup follows for each entry. Tags split by the shard option list
+ * buckets in place of their files, found by one seek of the index each,
+ * and a bucket lists the files in its range of ids.
+ * @see kwest_readdir
+ * @author Harshvardhan Pandit
+ */
+static void ll_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+                       struct fuse_file_info *fi, int plus)
+{
+	struct kwest_options *o = get_kwest_options();
+	struct fuse_entry_param e;
+	struct ll_dirbuf b;
+	sqlite3_stmt *stmt;
+	const char *name;
+	char bucket[QUERY_SIZE];
+	int tno = KW_DH_TNO(fi->fh);
+	int part = KW_DIROFF_PART(off);
+	int from = KW_DIROFF_ID(off);
+	int first = 0, last = INT_MAX; /* ids of files listed */
+	int id;
+	int res;
+
+	b.p = malloc(size);
+	b.size = size;
+	b.pos = 0;
+	if(b.p == NULL) {
+		reply_err(req, ENOMEM);
+		return;
+	}
+
+	if(part == KW_DIROFF_DOTS) {
+		if(from == 0 && add_dot(req, &b, ".", ino,
+		                KW_DIROFF(KW_DIROFF_DOTS, 1), plus) != KW_SUCCESS) {
+			goto reply;
+		}
+		if(add_dot(req, &b, "..", KW_INO_IS_SHARD(ino) ? tag_ino(tno) :
+		           FUSE_ROOT_ID, KW_DIROFF(KW_DIROFF_TAGS, 0),
+		           plus) != KW_SUCCESS) {
+			goto reply;
+		}
+		part = KW_DIROFF_TAGS;
+		from = 0;
+	}
+
+	/** bucket only holds files in its range */
+	if(KW_INO_IS_SHARD(ino)) {
+		shard_range(KW_INO_SHARD_K(ino), &first, &last);
+		if(part == KW_DIROFF_TAGS) {
+			part = KW_DIROFF_FILES;
+			from = 0;
+		}
+	}
+
+	/** get directories under tag */
+	if(part == KW_DIROFF_TAGS) {
+		stmt = get_subtags_by_tno(tno, from);
+		while((name = row_from_stmt(stmt, &id)) != NULL) {
+			if(plus) {
+				memset(&e, 0, sizeof(e));
+				e.ino = tag_ino(id);
+				e.generation = get_tag_generation(id);
+				fill_tag_attr(id, &e.attr);
+				e.entry_timeout = o->tag.entry;
+				e.attr_timeout = o->tag.attr;
+				res = dirbuf_add_plus(req, &b, name, &e,
+				              KW_DIROFF(KW_DIROFF_TAGS, id + 1));
+			} else {
+				res = dirbuf_add(req, &b, name, tag_ino(id),
+				      S_IFDIR, KW_DIROFF(KW_DIROFF_TAGS, id + 1));
+			}
+			if(res != KW_SUCCESS) {
+				sqlite3_finalize(stmt);
+				goto reply;
+			}
+		}
+		part = (fi->fh & KW_DH_SHARDED) ? KW_DIROFF_SHARDS :
+		                                  KW_DIROFF_FILES;
+		from = 0;
+	}
+
+	/** get buckets of files under tag, skipping empty ones */
+	while(part == KW_DIROFF_SHARDS && from >= 0 &&
+	      (id = get_next_fno_by_tno(tno, from)) != KW_FAIL) {
+		memset(&e, 0, sizeof(e));
+		e.ino = KW_INO_SHARD(tno, id / o->shard);
+		shard_range(id / o->shard, &first, &last);
+		snprintf(bucket, QUERY_SIZE, KW_SHARD_NAME, first, last);
+		if(plus) {
+			fill_shard_attr(e.ino, &e.attr);
+			e.entry_timeout = o->tag.entry;
+			e.attr_timeout = o->tag.attr;
+			res = dirbuf_add_plus(req, &b, bucket, &e,
+			                      KW_DIROFF(KW_DIROFF_SHARDS,
+			                                (long long)last + 1));
+		} else {
+			res = dirbuf_add(req, &b, bucket, e.ino, S_IFDIR,
+			                 KW_DIROFF(KW_DIROFF_SHARDS,
+			                           (long long)last + 1));
+		}
+		if(res != KW_SUCCESS || last == INT_MAX) {
+			goto reply;
+		}
+		from = last + 1;
+	}
+
+	/** get files under tag */
+	if(part == KW_DIROFF_FILES) {
+		stmt = get_files_by_tno_range(tno, (from > first) ? from : first,
+		                              last);
+		while((name = row_from_stmt(stmt, &id)) != NULL) {
+			if(plus) {
+				memset(&e, 0, sizeof(e));
+				if(fill_file_attr(id, (const char *)
+				   sqlite3_column_text(stmt, 2), &e.attr) != 0) {
+					continue; /* fails lookup as well */
+				}
+				e.ino = KW_INO_FILE(id);
+				e.generation = get_file_generation(id);
+				e.entry_timeout = o->file.entry;
+				e.attr_timeout = o->file.attr;
+				res = dirbuf_add_plus(req, &b, name, &e,
+				              KW_DIROFF(KW_DIROFF_FILES, id + 1));
+			} else {
+				res = dirbuf_add(req, &b, name, KW_INO_FILE(id),
+				     o->symlinks ? S_IFLNK : S_IFREG,
+				     KW_DIROFF(KW_DIROFF_FILES, id + 1));
+			}
+			if(res != KW_SUCCESS) {
+				sqlite3_finalize(stmt);
+				goto reply;
+			}
+		}
+	}
+
+reply:
+	fuse_reply_buf(req, b.p, b.pos);
+	free(b.p);
+}
+
+/**
+ * @fn static void kwest_ll_readdir(fuse_req_t req, fuse_ino_t ino,
+ *                                  size_t size, off_t off,
+ *                                  struct fuse_file_info *fi)
+ * @brief reply names of entries of tag starting at offset
+ * @see ll_readdir
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_readdir(fuse_req_t req, fuse_ino_t ino, size_t size,
+                             off_t off, struct fuse_file_info *fi)
+{
+	ll_readdir(req, ino, size, off, fi, 0);
+}
+
+/**
+ * @fn static void kwest_ll_readdirplus(fuse_req_t req, fuse_ino_t ino,
+ *                                      size_t size, off_t off,
+ *                                      struct fuse_file_info *fi)
+ * @brief reply entries of tag with their attributes starting at offset
+ * @see ll_readdir
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size,
+                                 off_t off, struct fuse_file_info *fi)
+{
+	ll_readdir(req, ino, size, off, fi, 1);
+}
+
+
+/**
+ * @fn static void kwest_ll_statfs(fuse_req_t req, fuse_ino_t ino)
+ * @brief reply filesystem statistics
+ * @details answered from counts kept in memory, without a database query
+ * @see get_statfs
+ * @author Harshvardhan Pandit
+ */
+static void kwest_ll_statfs(fuse_req_t req, fuse_ino_t ino)
+{
+	struct statvfs st;
+	(void)ino;
+
+	get_statfs(&st);
+	fuse_reply_statfs(req, &st);
+}
+
+
+/* __FUSE LOW LEVEL OPERATIONS STRUCTURE__ */
+
+/**
+ * @struct kwest_ll_oper
+ * @brief fuse low level operations as functions
+ * @note suggestions are only shown by the high level frontend
+ */
+static const struct fuse_lowlevel_ops kwest_ll_oper = {
+	.init		= kwest_ll_init,
+	.destroy	= kwest_ll_destroy,
+	.lookup		= kwest_ll_lookup,
+	.forget		= kwest_ll_forget,
+	.forget_multi	= kwest_ll_forget_multi,
+	.getattr	= kwest_ll_getattr,
+	.setattr	= kwest_ll_setattr,
+	.readlink	= kwest_ll_readlink,
+
+/* FILE RELATED FILESYSTEM OPERATIONS */
+	.open		= kwest_ll_open,
+	.read		= kwest_ll_read,
+	.write		= kwest_ll_write,
+	.release	= kwest_ll_release,
+	.flush		= kwest_ll_flush,
+	.fsync		= kwest_ll_fsync,
+	.create		= kwest_ll_create,
+	.link		= kwest_ll_link,
+	.copy_file_range = kwest_ll_copy_file_range,
+	.unlink		= kwest_ll_unlink,
+	.rename		= kwest_ll_rename,
+
+/* EXTENDED ATTRIBUTES */
+	.setxattr	= kwest_ll_setxattr,
+	.getxattr	= kwest_ll_getxattr,
+	.listxattr	= kwest_ll_listxattr,
+	.removexattr	= kwest_ll_removexattr,
+
+/* DIRECTORY RELATED FILESYSTEM OPERATIONS */
+	.mkdir		= kwest_ll_mkdir,
+	.rmdir		= kwest_ll_rmdir,
+	.opendir	= kwest_ll_opendir,
+	.readdir	= kwest_ll_readdir,
+	.readdirplus	= kwest_ll_readdirplus,
+	.statfs		= kwest_ll_statfs,
+};
+
+
+/* __STATISTICS__ */
+
+/* time operation of kwest_ll_oper, errors are counted by reply_err */
+#define STATS_CALL(op, call) \
+	uint64_t start = stats_start(op); \
+	call; \
+	stats_end(op, start)
+
+static void stats_lookup(fuse_req_t req, fuse_ino_t parent, const char *name)
+{
+	STATS_CALL(STATS_LOOKUP, kwest_ll_oper.lookup(req, parent, name));
+}
+
+static void stats_forget(fuse_req_t req, fuse_ino_t ino, uint64_t nlookup)
+{
+	STATS_CALL(STATS_FORGET, kwest_ll_oper.forget(req, ino, nlookup));
+}
+
+static void stats_forget_multi(fuse_req_t req, size_t count,
+                               struct fuse_forget_data *forgets)
+{
+	STATS_CALL(STATS_FORGET,
+	           kwest_ll_oper.forget_multi(req, count, forgets));
+}
+
+static void stats_getattr(fuse_req_t req, fuse_ino_t ino,
+                          struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_GETATTR, kwest_ll_oper.getattr(req, ino, fi));
+}
+
+static void stats_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr,
+                          int to_set, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_SETATTR,
+	           kwest_ll_oper.setattr(req, ino, attr, to_set, fi));
+}
+
+static void stats_readlink(fuse_req_t req, fuse_ino_t ino)
+{
+	STATS_CALL(STATS_READLINK, kwest_ll_oper.readlink(req, ino));
+}
+
+static void stats_open(fuse_req_t req, fuse_ino_t ino,
+                       struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_OPEN, kwest_ll_oper.open(req, ino, fi));
+}
+
+static void stats_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+                       struct fuse_file_info *fi)
+{
+	uint64_t start = stats_start(STATS_READ);
+
+	read_deferred = false;
+	kwest_ll_oper.read(req, ino, size, off, fi);
+	if(read_deferred) { /* timed till replied to, see ll_read_loop */
+		stats_detach();
+	} else {
+		stats_end(STATS_READ, start);
+	}
+}
+
+static void stats_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
+                        size_t size, off_t off, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_WRITE,
+	           kwest_ll_oper.write(req, ino, buf, size, off, fi));
+}
+
+static void stats_release(fuse_req_t req, fuse_ino_t ino,
+                          struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_RELEASE, kwest_ll_oper.release(req, ino, fi));
+}
+
+static void stats_flush(fuse_req_t req, fuse_ino_t ino,
+                        struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_FLUSH, kwest_ll_oper.flush(req, ino, fi));
+}
+
+static void stats_fsync(fuse_req_t req, fuse_ino_t ino, int datasync,
+                        struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_FSYNC, kwest_ll_oper.fsync(req, ino, datasync, fi));
+}
+
+static void stats_create(fuse_req_t req, fuse_ino_t parent, const char *name,
+                         mode_t mode, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_CREATE,
+	           kwest_ll_oper.create(req, parent, name, mode, fi));
+}
+
+static void stats_link(fuse_req_t req, fuse_ino_t ino, fuse_ino_t newparent,
+                       const char *newname)
+{
+	STATS_CALL(STATS_LINK,
+	           kwest_ll_oper.link(req, ino, newparent, newname));
+}
+
+static void stats_copy_file_range(fuse_req_t req, fuse_ino_t ino_in,
+                                  off_t off_in, struct fuse_file_info *fi_in,
+                                  fuse_ino_t ino_out, off_t off_out,
+                                  struct fuse_file_info *fi_out, size_t len,
+                                  int flags)
+{
+	STATS_CALL(STATS_COPY_FILE_RANGE,
+	           kwest_ll_oper.copy_file_range(req, ino_in, off_in, fi_in,
+	                                         ino_out, off_out, fi_out,
+	                                         len, flags));
+}
+
+static void stats_unlink(fuse_req_t req, fuse_ino_t parent, const char *name)
+{
+	STATS_CALL(STATS_UNLINK, kwest_ll_oper.unlink(req, parent, name));
+}
+
+static void stats_rename(fuse_req_t req, fuse_ino_t parent, const char *name,
+                         fuse_ino_t newparent, const char *newname,
+                         unsigned int flags)
+{
+	STATS_CALL(STATS_RENAME,
+	           kwest_ll_oper.rename(req, parent, name, newparent, newname,
+	                                flags));
+}
+
+static void stats_setxattr(fuse_req_t req, fuse_ino_t ino, const char *name,
+                           const char *value, size_t size, int flags)
+{
+	STATS_CALL(STATS_SETXATTR,
+	           kwest_ll_oper.setxattr(req, ino, name, value, size, flags));
+}
+
+static void stats_getxattr(fuse_req_t req, fuse_ino_t ino, const char *name,
+                           size_t size)
+{
+	STATS_CALL(STATS_GETXATTR,
+	           kwest_ll_oper.getxattr(req, ino, name, size));
+}
+
+static void stats_listxattr(fuse_req_t req, fuse_ino_t ino, size_t size)
+{
+	STATS_CALL(STATS_LISTXATTR, kwest_ll_oper.listxattr(req, ino, size));
+}
+
+static void stats_removexattr(fuse_req_t req, fuse_ino_t ino,
+                              const char *name)
+{
+	STATS_CALL(STATS_REMOVEXATTR,
+	           kwest_ll_oper.removexattr(req, ino, name));
+}
+
+static void stats_statfs(fuse_req_t req, fuse_ino_t ino)
+{
+	STATS_CALL(STATS_STATFS, kwest_ll_oper.statfs(req, ino));
+}
+
+static void stats_mkdir(fuse_req_t req, fuse_ino_t parent, const char *name,
+                        mode_t mode)
+{
+	STATS_CALL(STATS_MKDIR, kwest_ll_oper.mkdir(req, parent, name, mode));
+}
+
+static void stats_rmdir(fuse_req_t req, fuse_ino_t parent, const char *name)
+{
+	STATS_CALL(STATS_RMDIR, kwest_ll_oper.rmdir(req, parent, name));
+}
+
+static void stats_opendir(fuse_req_t req, fuse_ino_t ino,
+                          struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_OPENDIR, kwest_ll_oper.opendir(req, ino, fi));
+}
+
+static void stats_readdir(fuse_req_t req, fuse_ino_t ino, size_t size,
+                          off_t off, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_READDIR,
+	           kwest_ll_oper.readdir(req, ino, size, off, fi));
+}
+
+static void stats_readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size,
+                              off_t off, struct fuse_file_info *fi)
+{
+	STATS_CALL(STATS_READDIRPLUS,
+	           kwest_ll_oper.readdirplus(req, ino, size, off, fi));
+}
+
+/**
+ * @struct kwest_ll_stats_oper
+ * @brief operations of kwest_ll_oper, timed for the stats file
+ * @note operations added to kwest_ll_oper need a wrapper here
+ * @see stats.c
+ */
+static const struct fuse_lowlevel_ops kwest_ll_stats_oper = {
+	.init		= kwest_ll_init,
+	.destroy	= kwest_ll_destroy,
+	.lookup		= stats_lookup,
+	.forget		= stats_forget,
+	.forget_multi	= stats_forget_multi,
+	.getattr	= stats_getattr,
+	.setattr	= stats_setattr,
+	.readlink	= stats_readlink,
+	.open		= stats_open,
+	.read		= stats_read,
+	.write		= stats_write,
+	.release	= stats_release,
+	.flush		= stats_flush,
+	.fsync		= stats_fsync,
+	.create		= stats_create,
+	.link		= stats_link,
+	.copy_file_range = stats_copy_file_range,
+	.unlink		= stats_unlink,
+	.rename		= stats_rename,
+	.setxattr	= stats_setxattr,
+	.getxattr	= stats_getxattr,
+	.listxattr	= stats_listxattr,
+	.removexattr	= stats_removexattr,
+	.mkdir		= stats_mkdir,
+	.rmdir		= stats_rmdir,
+	.opendir	= stats_opendir,
+	.readdir	= stats_readdir,
+	.readdirplus	= stats_readdirplus,
+	.statfs		= stats_statfs,
+};
+
+
+/**
+ * @var kwest_opts
+ * @brief kwest specific mount options
+ * @see fuseopts.h
+ */
+static const struct fuse_opt kwest_opts[] = {
+	KWEST_FUSE_OPTS,
+	FUSE_OPT_END
+};
+
+/**
+ * @fn static int ll_uring_supported(void)
+ * @brief check if requests can be carried over io_uring
+ * @details needs libfuse 3.18+ and linux 6.14+ with the enable_uring
+ * parameter of the fuse module set, otherwise requests are read from and
+ * replied to on /dev/fuse, a system call each
+ * @return 1 if supported, 0 otherwise
+ * @author Harshvardhan Pandit
+ */
+static int ll_uring_supported(void)
+{
+#if defined(FUSE_MAKE_VERSION) && FUSE_VERSION >= FUSE_MAKE_VERSION(3, 18)
+	FILE *param = fopen(LL_URING_PARAM, "r");
+	int c = EOF;
+
+	if(param != NULL) {
+		c = fgetc(param);
+		fclose(param);
+	}
+	return c == 'Y' || c == '1';
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @fn int call_fuse_daemon(int argc, char **argv)
+ * @brief pass control to fuse low level session loop
+ * @param argc argument count from main
+ * @param argv argument values from main
+ * @return 0 on SUCCESS
+ * @return 1 on error
+ * @author Harshvardhan Pandit
+ */
+int call_fuse_daemon(int argc, char **argv)
+{
+	struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
+	struct fuse_cmdline_opts opts;
+	struct fuse_loop_config config;
+	struct fuse_session *se;
+	int ret = 1;
+
+	if(fuse_opt_parse(&args, get_kwest_options(), kwest_opts, NULL) == -1 ||
+	   fuse_parse_cmdline(&args, &opts) != 0) {
+		return 1;
+	}
+	if(opts.show_help) {
+		printf("usage: %s [options] <mountpoint>\n\n", argv[0]);
+		fuse_cmdline_help();
+		fuse_lowlevel_help();
+		ret = 0;
+		goto out_args;
+	} else if(opts.show_version) {
+		fuse_lowlevel_version();
+		ret = 0;
+		goto out_args;
+	}
+	if(opts.mountpoint == NULL) {
+		printf("usage: %s [options] <mountpoint>\n", argv[0]);
+		goto out_args;
+	}
+	/* io_uring option of libfuse is only passed on where it is known,
+	 * as unknown options fail the session */
+	if(get_kwest_options()->io_uring) {
+		if(ll_uring_supported() &&
+		   fuse_opt_add_arg(&args, "-oio_uring") == 0) {
+			log_msg("ll: requests over io_uring");
+		} else {
+			log_msg("ll: no io_uring, requests over /dev/fuse");
+		}
+	}
+
+	se = fuse_session_new(&args, &kwest_ll_stats_oper,
+	                      sizeof(kwest_ll_stats_oper),
+	                      NULL);
+	if(se == NULL) {
+		goto out_args;
+	}
+	ll_se = se;
+	if(fuse_set_signal_handlers(se) != 0) {
+		goto out_session;
+	}
+	if(fuse_session_mount(se, opts.mountpoint) != 0) {
+		goto out_signals;
+	}
+
+	fuse_daemonize(opts.foreground);
+	if(opts.singlethread) {
+		ret = fuse_session_loop(se);
+	} else {
+		config.clone_fd = opts.clone_fd;
+		config.max_idle_threads = opts.max_idle_threads;
+		ret = fuse_session_loop_mt(se, &config);
+	}
+
+	fuse_session_unmount(se);
+out_signals:
+	fuse_remove_signal_handlers(se);
+out_session:
+	fuse_session_destroy(se);
+out_args:
+	free(opts.mountpoint);
+	fuse_opt_free_args(&args);
+	return ret ? 1 : 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file fuseopts.c
+ * @brief mount options understood by kwest
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fuseopts.h"
+
+/**
+ * @brief get options kwest was mounted with
+ * @details options hold the defaults till the fuse frontend parses the
+ * command line into them
+ * @param void
+ * @return pointer to options
+ * @author HP
+ */
+struct kwest_options *get_kwest_options(void)
+{
+	/* defaults are the ones used by libfuse */
+	static struct kwest_options options = {
+		{ 1.0, 1.0, 0.0 }, /* tag */
+		{ 1.0, 1.0, 0.0 }, /* file */
+		{ 1.0, 1.0, 0.0 }, /* suggest */
+		1.0,               /* stat_timeout */
+		1,                 /* passthrough */
+		0,                 /* writeback */
+		0,                 /* io_uring */
+		0,                 /* async_reads, off */
+		0,                 /* symlinks */
+		0,                 /* shard, off */
+		NULL               /* store, STORE_DIR in config directory */
+	};
+
+	return &options;
+}
+
+/**
+ * @brief smallest value of a, b and c
+ * @author HP
+ */
+static double min3(double a, double b, double c)
+{
+	double m = (a < b) ? a : b;
+	return (m < c) ? m : c;
+}
+
+/**
+ * @brief smallest timeouts over all entry classes
+ * @details used where timeouts cannot be given per entry, so that no entry
+ * is cached by the kernel longer than asked for
+ * @param t filled with smallest timeouts
+ * @return void
+ * @author HP
+ */
+void kwest_min_timeouts(struct kwest_timeouts *t)
+{
+	struct kwest_options *o = get_kwest_options();
+
+	t->entry = min3(o->tag.entry, o->file.entry, o->suggest.entry);
+	t->attr = min3(o->tag.attr, o->file.attr, o->suggest.attr);
+	t->negative = min3(o->tag.negative, o->file.negative,
+	                   o->suggest.negative);
+}
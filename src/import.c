@@ -29,6 +29,7 @@
 
 #include "import.h"
 #include "dbbasic.h"
+#include "fusecache.h"
 #include "logging.h"
 #include "flags.h"
 #include "magicstrings.h"
@@ -87,6 +88,7 @@ static int import_semantics(const char *path,const char *dirname)
 		
 			if(add_tag(entry->d_name,USER_TAG) == KW_SUCCESS){
 				printf("Created Tag : %s\n",entry->d_name);
+				pathcache_invalidate_name(entry->d_name);
 			}
 			/* Access Sub-Directories */
 			import_semantics(full_name,entry->d_name);
@@ -122,6 +124,7 @@ int import(const char *path)
 	/* Create Tag for directory to be imported */
 	if(add_tag(dirname, USER_TAG) == KW_SUCCESS){
 		printf("Creating Tag : %s\n",dirname);
+		pathcache_invalidate_name(dirname);
 		add_association(dirname, TAG_FILES, ASSOC_SUBGROUP);
 	}
 	if (import_semantics(path, dirname) == KW_SUCCESS) {
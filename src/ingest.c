@@ -0,0 +1,296 @@
+/**
+ * @file ingest.c
+ * @brief metadata of written files extracted in the background
+ * @details plugins read a whole file to extract its metadata, so a file
+ * written through kwest is queued here when its handle is released, and
+ * a single thread extracts queued files one at a time. The writer does
+ * not wait for the plugins, and the plugins are never run concurrently
+ * by this thread.
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "ingest.h"
+#include "dbbasic.h"
+#include "logging.h"
+#include "flags.h"
+
+/**
+ * @struct ingest_entry
+ * @brief file queued for extraction
+ */
+struct ingest_entry {
+	int fno;
+	struct ingest_entry *next;
+};
+
+/**
+ * @struct ingest_file
+ * @brief file open for writing, queued once its last handle is closed if
+ * it was written
+ */
+struct ingest_file {
+	int fno;
+	int opens;             /* handles open for writing */
+	bool written;          /* written through kwest or on disk */
+	struct timespec mtime; /* modification time on first open */
+	struct ingest_file *next;
+};
+
+static struct ingest_file *ingest_open_files = NULL; /* few at a time */
+static struct ingest_entry *ingest_head = NULL;
+static struct ingest_entry **ingest_tail = &ingest_head;
+static pthread_mutex_t ingest_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ingest_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t ingest_thread;
+static bool ingest_running = false;
+
+/**
+ * @brief extract metadata of queued files till stopped
+ * @param arg unused
+ * @return NULL
+ * @author HP
+ */
+static void *ingest_loop(void *arg)
+{
+	struct ingest_entry *n;
+	(void)arg;
+
+	pthread_mutex_lock(&ingest_lock);
+	while (1) {
+		while (ingest_head == NULL && ingest_running) {
+			pthread_cond_wait(&ingest_cond, &ingest_lock);
+		}
+		if (ingest_head == NULL) {
+			break;
+		}
+		n = ingest_head;
+		ingest_head = n->next;
+		if (ingest_head == NULL) {
+			ingest_tail = &ingest_head;
+		}
+		pthread_mutex_unlock(&ingest_lock);
+
+		if (add_file_metadata(n->fno) != KW_SUCCESS) {
+			log_msg("ingest: no metadata for %d", n->fno);
+		}
+		free(n);
+
+		pthread_mutex_lock(&ingest_lock);
+	}
+	pthread_mutex_unlock(&ingest_lock);
+	return NULL;
+}
+
+/**
+ * @brief start extracting metadata of queued files in the background
+ * @param void
+ * @return KW_SUCCESS: SUCCESS, KW_FAIL: FAIL
+ * @author HP
+ */
+int ingest_start(void)
+{
+	ingest_running = true;
+	if (pthread_create(&ingest_thread, NULL, ingest_loop, NULL) != 0) {
+		ingest_running = false;
+		return KW_FAIL;
+	}
+	return KW_SUCCESS;
+}
+
+/**
+ * @brief stop extracting metadata in the background, after files queued
+ * @param void
+ * @return void
+ * @author HP
+ */
+void ingest_stop(void)
+{
+	if (!ingest_running) {
+		return;
+	}
+	pthread_mutex_lock(&ingest_lock);
+	ingest_running = false;
+	pthread_cond_signal(&ingest_cond);
+	pthread_mutex_unlock(&ingest_lock);
+	pthread_join(ingest_thread, NULL);
+}
+
+/**
+ * @brief find file open for writing
+ * @param fno file id
+ * @return pointer to link holding file, holding NULL if not open
+ * @note called with ingest_lock held
+ * @author HP
+ */
+static struct ingest_file **ingest_find(int fno)
+{
+	struct ingest_file **f;
+
+	for (f = &ingest_open_files; *f != NULL; f = &(*f)->next) {
+		if ((*f)->fno == fno) {
+			break;
+		}
+	}
+	return f;
+}
+
+/**
+ * @brief note handle of file opened for writing
+ * @param fno file id
+ * @param fd descriptor of backing file
+ * @return void
+ * @see ingest_close
+ * @author HP
+ */
+void ingest_open(int fno, int fd)
+{
+	struct ingest_file **f;
+	struct stat st;
+
+	if (fno < 0 || fstat(fd, &st) == -1) {
+		return;
+	}
+	pthread_mutex_lock(&ingest_lock);
+	f = ingest_find(fno);
+	if (*f == NULL && (*f = calloc(1, sizeof(struct ingest_file)))) {
+		(*f)->fno = fno;
+		(*f)->mtime = st.st_mtim;
+	}
+	if (*f != NULL) {
+		(*f)->opens++;
+	}
+	pthread_mutex_unlock(&ingest_lock);
+}
+
+/**
+ * @brief note that file was written
+ * @details writes are also seen from the modification time of the file
+ * when it is closed, this catches those made within its resolution. A
+ * file not open for writing, as one truncated by path, is queued at once.
+ * @param fno file id
+ * @return void
+ * @author HP
+ */
+void ingest_written(int fno)
+{
+	struct ingest_file *f;
+
+	if (fno < 0) {
+		return;
+	}
+	pthread_mutex_lock(&ingest_lock);
+	f = *ingest_find(fno);
+	if (f != NULL) {
+		f->written = true;
+	}
+	pthread_mutex_unlock(&ingest_lock);
+
+	if (f == NULL) {
+		ingest_queue(fno);
+	}
+}
+
+/**
+ * @brief note handle of file opened for writing being closed
+ * @details once its last handle is closed, a file that was written is
+ * queued for extraction. Files only opened for writing, as by players and
+ * tag editors that open files read-write, are not extracted again.
+ * @param fno file id
+ * @param fd descriptor of backing file, still open
+ * @return void
+ * @author HP
+ */
+void ingest_close(int fno, int fd)
+{
+	struct ingest_file **link, *f;
+	struct stat st;
+	bool queue = false;
+
+	if (fno < 0) {
+		return;
+	}
+	pthread_mutex_lock(&ingest_lock);
+	link = ingest_find(fno);
+	f = *link;
+	if (f == NULL) {
+		pthread_mutex_unlock(&ingest_lock);
+		return;
+	}
+	if (fstat(fd, &st) == 0 &&
+	    (st.st_mtim.tv_sec != f->mtime.tv_sec ||
+	     st.st_mtim.tv_nsec != f->mtime.tv_nsec)) {
+		f->written = true;
+	}
+	if (--f->opens == 0) {
+		*link = f->next;
+		queue = f->written;
+		free(f);
+	}
+	pthread_mutex_unlock(&ingest_lock);
+
+	if (queue) {
+		ingest_queue(fno);
+	}
+}
+
+/**
+ * @brief queue file for extraction of its metadata
+ * @details a file already waiting in the queue is not queued again, as
+ * its metadata is extracted from its contents when it leaves the queue
+ * @param fno file id
+ * @return void
+ * @note without the background thread, files are not queued and keep
+ * the metadata they were added with
+ * @author HP
+ */
+void ingest_queue(int fno)
+{
+	struct ingest_entry *n;
+
+	if (fno < 0) {
+		return;
+	}
+	pthread_mutex_lock(&ingest_lock);
+	if (!ingest_running) {
+		pthread_mutex_unlock(&ingest_lock);
+		return;
+	}
+	for (n = ingest_head; n != NULL; n = n->next) {
+		if (n->fno == fno) {
+			pthread_mutex_unlock(&ingest_lock);
+			return;
+		}
+	}
+	n = malloc(sizeof(struct ingest_entry));
+	if (n == NULL) {
+		pthread_mutex_unlock(&ingest_lock);
+		return;
+	}
+	n->fno = fno;
+	n->next = NULL;
+	*ingest_tail = n;
+	ingest_tail = &n->next;
+	pthread_cond_signal(&ingest_cond);
+	pthread_mutex_unlock(&ingest_lock);
+}
@@ -48,7 +48,7 @@ $fusermount -u mnt
 @subsection dependson Dependencies:
 @code
 gcc
-fuse version 2.8+
+fuse version 2.9+
 	$sudo apt-get install fuse libfuse-dev
 sqlite3 3.7.0+
 	$sudo apt-get install sqlite3 libsqlite3-dev
@@ -90,6 +90,7 @@ taglib 1.7+
 
 #include "fusefunc.h"
 #include "dbinit.h"
+#include "dbbasic.h"
 #include "apriori.h"
 #include "dbconsistency.h"
 #include "import.h"
@@ -148,6 +149,8 @@ int main(int argc, char *argv[])
 	begin_transaction();
 	create_db();
 	commit_transaction();
+	/** count catalog, kept up to date from here on */
+	load_catalog_counts();
 	/** load plugins */
 	begin_transaction();
 	ret = plugins_add_plugin(load_taglib_plugin());
@@ -183,6 +186,8 @@ int main(int argc, char *argv[])
 	if(stderror != NULL) { /* restore stderr to stdout */
 		stderr = stderror;
 	}
+	/** filter names of catalog, kept up to date from here on */
+	load_catalog_names();
 	/** pass control to fuse daemon */
 	return call_fuse_daemon(argc,argv);
 	/** file system is now LIVE */
@@ -84,10 +84,13 @@ int log_init(void)
  */
 void log_msg(const char *msg, ...)
 {
+    FILE *logfile = get_logfile();
     va_list argptr;
     va_start(argptr, msg);
-    vfprintf(get_logfile(), msg, argptr);
-    vfprintf(get_logfile(), "\n", argptr);
+    flockfile(logfile); /* keep messages of fuse threads on their own lines */
+    vfprintf(logfile, msg, argptr);
+    fputc('\n', logfile);
+    funlockfile(logfile);
     va_end(argptr);
 }
 
@@ -2,6 +2,7 @@
 #include "metadata_format.h"
 #include "logging.h"
 #include "plugins_extraction.h"
+#include "stats.h"
 
 #include <string.h>
 
@@ -34,7 +35,9 @@ int metadata_extract(const char *file, struct kw_metadata *s)
 	while (head != NULL) {
 		if (head->plugin->is_of_type(file) == true) {
 			printf("plugin used: %s\n",head->plugin->name);
+			uint64_t start = stats_now();
 			int ret = head->plugin->p_metadata_extract(file, s);
+			stats_plugin(head->plugin->name, start, ret != KW_SUCCESS);
 			if (ret == KW_SUCCESS) {
 				/*dump_metadata(s);*/
 				return KW_SUCCESS;
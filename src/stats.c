@@ -0,0 +1,460 @@
+/**
+ * @file stats.c
+ * @brief counters and latency histograms of kwest operations
+ * @details every thread counts into a block of its own, so counting takes
+ * no lock and shares no cache line with other threads. Blocks are summed
+ * only when a report is asked for. A block is handed to a new thread once
+ * its thread exits, and keeps the counts made till then.
+ * @author Harshvardhan Pandit
+ * @date March 2013
+ */
+
+/* LICENSE
+ * Copyright 2013 Harshvardhan Pandit
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "stats.h"
+
+#define STATS_BUCKETS 32 /* bucket b holds latencies below 2^b us */
+#define STATS_PLUGINS 8  /* plugins timed */
+
+/* counters are written by their thread only, and read by reports */
+#define STATS_ADD(x, n) __atomic_store_n(&(x), (x) + (n), __ATOMIC_RELAXED)
+#define STATS_GET(x)    __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+/**
+ * @struct stats_hist
+ * @brief calls and latency histogram of an operation or plugin
+ */
+struct stats_hist {
+	uint64_t calls;
+	uint64_t errors;
+	uint64_t sql;    /* statements run */
+	uint64_t max_ns; /* slowest call */
+	uint64_t buckets[STATS_BUCKETS];
+};
+
+/**
+ * @struct stats_block
+ * @brief counters of one thread
+ */
+struct stats_block {
+	struct stats_hist op[STATS_OPS];
+	struct stats_hist plugin[STATS_PLUGINS];
+	uint64_t counter[STATS_COUNTERS];
+	int op_now;  /* operation being served, STATS_OTHER if none */
+	int in_use;  /* held by a running thread */
+	struct stats_block *next;
+};
+
+static const char *stats_op_names[STATS_OPS] = {
+	"other", "lookup", "forget", "getattr", "setattr", "readlink",
+	"mknod", "mkdir", "unlink", "rmdir", "rename", "link", "chmod",
+	"chown", "truncate", "utimens", "open", "create", "read", "write",
+	"copy_file_range", "flush", "fsync", "release", "opendir",
+	"readdir", "readdirplus", "releasedir", "access", "setxattr",
+	"getxattr", "listxattr", "removexattr", "statfs"
+};
+
+static struct stats_block *stats_blocks = NULL; /* never freed */
+static const char *stats_plugin_names[STATS_PLUGINS];
+static pthread_key_t stats_key; /* block of each thread */
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief hand block of exiting thread over to the next new thread
+ * @author HP
+ */
+static void stats_release(void *block)
+{
+	__atomic_store_n(&((struct stats_block *)block)->in_use, 0,
+	                 __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief create key holding block of each thread
+ * @author HP
+ */
+static void stats_init(void)
+{
+	pthread_key_create(&stats_key, stats_release);
+}
+
+/**
+ * @brief block of calling thread, taken on first use
+ * @return block, NULL on memory error
+ * @author HP
+ */
+static struct stats_block *stats_self(void)
+{
+	struct stats_block *b;
+	int unused;
+
+	pthread_once(&stats_once, stats_init);
+	b = pthread_getspecific(stats_key);
+	if (b != NULL) {
+		return b;
+	}
+
+	for (b = __atomic_load_n(&stats_blocks, __ATOMIC_ACQUIRE); b != NULL;
+	     b = b->next) {
+		unused = 0;
+		if (__atomic_compare_exchange_n(&b->in_use, &unused, 1, false,
+		                                __ATOMIC_ACQUIRE,
+		                                __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+	if (b == NULL) {
+		b = calloc(1, sizeof(struct stats_block));
+		if (b == NULL) {
+			return NULL;
+		}
+		b->in_use = 1;
+		b->next = __atomic_load_n(&stats_blocks, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&stats_blocks, &b->next, b,
+		                                    false, __ATOMIC_RELEASE,
+		                                    __ATOMIC_RELAXED));
+	}
+	b->op_now = STATS_OTHER;
+	pthread_setspecific(stats_key, b);
+	return b;
+}
+
+/**
+ * @brief monotonic time in nanoseconds
+ * @param void
+ * @return time
+ * @author HP
+ */
+uint64_t stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief add call taking ns nanoseconds to histogram
+ * @author HP
+ */
+static void stats_hist_add(struct stats_hist *h, uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	int b = 0;
+
+	while (us > 0 && b < STATS_BUCKETS - 1) {
+		us >>= 1;
+		b++;
+	}
+	STATS_ADD(h->calls, 1);
+	STATS_ADD(h->buckets[b], 1);
+	if (ns > h->max_ns) {
+		__atomic_store_n(&h->max_ns, ns, __ATOMIC_RELAXED);
+	}
+}
+
+/**
+ * @brief start timing operation served by this thread
+ * @param op operation, one of enum stats_op
+ * @return start time, given back to stats_end
+ * @author HP
+ */
+uint64_t stats_start(int op)
+{
+	struct stats_block *b = stats_self();
+
+	if (b != NULL) {
+		b->op_now = op;
+	}
+	return stats_now();
+}
+
+/**
+ * @brief count error of operation being served by this thread
+ * @param void
+ * @return void
+ * @author HP
+ */
+void stats_error(void)
+{
+	struct stats_block *b = stats_self();
+
+	if (b != NULL) {
+		STATS_ADD(b->op[b->op_now].errors, 1);
+	}
+}
+
+/**
+ * @brief end timing operation started with stats_start
+ * @param op operation given to stats_start
+ * @param start time returned by stats_start
+ * @return void
+ * @author HP
+ */
+void stats_end(int op, uint64_t start)
+{
+	struct stats_block *b = stats_self();
+
+	if (b != NULL) {
+		stats_hist_add(&b->op[op], stats_now() - start);
+		b->op_now = STATS_OTHER;
+	}
+}
+
+/**
+ * @brief stop serving operation started with stats_start without timing
+ * it, as its reply is made later by another thread which times it
+ * @param void
+ * @return void
+ * @author HP
+ */
+void stats_detach(void)
+{
+	struct stats_block *b = stats_self();
+
+	if (b != NULL) {
+		b->op_now = STATS_OTHER;
+	}
+}
+
+/**
+ * @brief count statement run by this thread, for operation being served
+ * @param void
+ * @return void
+ * @author HP
+ */
+void stats_sql(void)
+{
+	struct stats_block *b = stats_self();
+
+	if (b != NULL) {
+		STATS_ADD(b->op[b->op_now].sql, 1);
+	}
+}
+
+/**
+ * @brief count event
+ * @param counter event, one of enum stats_counter
+ * @return void
+ * @author HP
+ */
+void stats_count(int counter)
+{
+	struct stats_block *b = stats_self();
+
+	if (b != NULL) {
+		STATS_ADD(b->counter[counter], 1);
+	}
+}
+
+/**
+ * @brief record time taken by plugin to extract metadata
+ * @details plugins get a slot on their first extraction, those beyond
+ * STATS_PLUGINS are not timed
+ * @param name name of plugin
+ * @param start time returned by stats_now before extraction
+ * @param failed non zero if extraction failed
+ * @return void
+ * @author HP
+ */
+void stats_plugin(const char *name, uint64_t start, int failed)
+{
+	struct stats_block *b = stats_self();
+	const char *slot;
+	int i = 0;
+
+	while (b != NULL && i < STATS_PLUGINS) {
+		slot = __atomic_load_n(&stats_plugin_names[i],
+		                       __ATOMIC_ACQUIRE);
+		if (slot == NULL &&
+		    !__atomic_compare_exchange_n(&stats_plugin_names[i], &slot,
+		                                 name, false, __ATOMIC_ACQ_REL,
+		                                 __ATOMIC_ACQUIRE)) {
+			continue; /* taken by another plugin meanwhile */
+		}
+		if (slot == NULL || strcmp(slot, name) == 0) {
+			stats_hist_add(&b->plugin[i], stats_now() - start);
+			if (failed) {
+				STATS_ADD(b->plugin[i].errors, 1);
+			}
+			return;
+		}
+		i++;
+	}
+}
+
+/**
+ * @brief add histogram into sum
+ * @author HP
+ */
+static void stats_hist_sum(struct stats_hist *sum, struct stats_hist *h)
+{
+	uint64_t max = STATS_GET(h->max_ns);
+	int i;
+
+	sum->calls += STATS_GET(h->calls);
+	sum->errors += STATS_GET(h->errors);
+	sum->sql += STATS_GET(h->sql);
+	if (max > sum->max_ns) {
+		sum->max_ns = max;
+	}
+	for (i = 0; i < STATS_BUCKETS; i++) {
+		sum->buckets[i] += STATS_GET(h->buckets[i]);
+	}
+}
+
+/**
+ * @brief latency below which the given share of calls complete
+ * @return upper bound of histogram bucket in microseconds
+ * @author HP
+ */
+static uint64_t stats_percentile(struct stats_hist *h, int percent)
+{
+	uint64_t want = (h->calls * percent + 99) / 100;
+	uint64_t seen = 0;
+	int i;
+
+	for (i = 0; i < STATS_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= want) {
+			break;
+		}
+	}
+	return (uint64_t)1 << ((i < STATS_BUCKETS) ? i : STATS_BUCKETS - 1);
+}
+
+/**
+ * @brief print histogram as a line of report
+ * @author HP
+ */
+static void stats_print_hist(FILE *out, const char *name,
+                             struct stats_hist *h, bool sql)
+{
+	fprintf(out, "%-16s %10llu %8llu", name,
+	        (unsigned long long)h->calls, (unsigned long long)h->errors);
+	if (sql) {
+		fprintf(out, " %10llu", (unsigned long long)h->sql);
+	}
+	if (h->calls == 0) {
+		fprintf(out, " %8s %8s %10s\n", "-", "-", "-");
+		return;
+	}
+	fprintf(out, " %8llu %8llu %10llu\n",
+	        (unsigned long long)stats_percentile(h, 50),
+	        (unsigned long long)stats_percentile(h, 99),
+	        (unsigned long long)(h->max_ns / 1000));
+}
+
+/**
+ * @brief print hits and misses of a cache as a line of report
+ * @author HP
+ */
+static void stats_print_cache(FILE *out, const char *name, uint64_t hits,
+                              uint64_t misses)
+{
+	fprintf(out, "%-16s %10llu %10llu %5.1f%%\n", name,
+	        (unsigned long long)hits, (unsigned long long)misses,
+	        (hits + misses) ? 100.0 * hits / (hits + misses) : 0.0);
+}
+
+/**
+ * @brief report of all counters as text
+ * @details latencies are in microseconds, p50 and p99 being the upper
+ * bounds of the histogram buckets holding them
+ * @param len set to length of report, may be NULL
+ * @return terminated report to be freed by caller, NULL on memory error
+ * @author HP
+ */
+char *stats_report(size_t *len)
+{
+	struct stats_block *sum = calloc(1, sizeof(struct stats_block));
+	struct stats_block *b;
+	const char *name;
+	char *report = NULL;
+	size_t size;
+	FILE *out;
+	int i;
+
+	if (sum == NULL) {
+		return NULL;
+	}
+	for (b = __atomic_load_n(&stats_blocks, __ATOMIC_ACQUIRE); b != NULL;
+	     b = b->next) {
+		for (i = 0; i < STATS_OPS; i++) {
+			stats_hist_sum(&sum->op[i], &b->op[i]);
+		}
+		for (i = 0; i < STATS_PLUGINS; i++) {
+			stats_hist_sum(&sum->plugin[i], &b->plugin[i]);
+		}
+		for (i = 0; i < STATS_COUNTERS; i++) {
+			sum->counter[i] += STATS_GET(b->counter[i]);
+		}
+	}
+
+	out = open_memstream(&report, &size);
+	if (out == NULL) {
+		free(sum);
+		return NULL;
+	}
+
+	fprintf(out, "%-16s %10s %8s %10s %8s %8s %10s\n", "operation",
+	        "calls", "errors", "sql", "p50(us)", "p99(us)", "max(us)");
+	for (i = 0; i < STATS_OPS; i++) {
+		if (sum->op[i].calls > 0 || sum->op[i].sql > 0) {
+			stats_print_hist(out, stats_op_names[i], &sum->op[i],
+			                 true);
+		}
+	}
+
+	fprintf(out, "\n%-16s %10s %10s %6s\n", "cache", "hits", "misses",
+	        "hit");
+	stats_print_cache(out, "pathcache",
+	                  sum->counter[STATS_PATHCACHE_HIT],
+	                  sum->counter[STATS_PATHCACHE_MISS]);
+	stats_print_cache(out, "statcache",
+	                  sum->counter[STATS_STATCACHE_HIT],
+	                  sum->counter[STATS_STATCACHE_MISS]);
+	stats_print_cache(out, "suggestcache",
+	                  sum->counter[STATS_SUGGESTCACHE_HIT],
+	                  sum->counter[STATS_SUGGESTCACHE_MISS]);
+	stats_print_cache(out, "namefilter",
+	                  sum->counter[STATS_NAMEFILTER_HIT],
+	                  sum->counter[STATS_NAMEFILTER_MISS]);
+
+	fprintf(out, "\n%-16s %10s %8s %8s %8s %10s\n", "plugin", "calls",
+	        "errors", "p50(us)", "p99(us)", "max(us)");
+	for (i = 0; i < STATS_PLUGINS; i++) {
+		name = __atomic_load_n(&stats_plugin_names[i],
+		                       __ATOMIC_ACQUIRE);
+		if (name != NULL) {
+			stats_print_hist(out, name, &sum->plugin[i], false);
+		}
+	}
+
+	fclose(out);
+	free(sum);
+	if (len != NULL) {
+		*len = size;
+	}
+	return report;
+}
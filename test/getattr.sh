@@ -0,0 +1,45 @@
+# compare getattr heavy workloads through kwest_ll over the /dev/fuse loop
+# and over io_uring, run from src after make kwest_ll
+# kernel caches are turned off so that every stat reaches kwest
+# io_uring needs libfuse 3.18+, linux 6.14+ and the fuse module parameter
+# enable_uring set, otherwise both runs use /dev/fuse, see kwest.log
+# usage: sh ../test/getattr.sh <tag under mnt> [rounds]
+TAG=$1
+ROUNDS=${2:-100}
+TIMEOUTS=tag_entry_timeout=0,tag_attr_timeout=0
+TIMEOUTS=$TIMEOUTS,file_entry_timeout=0,file_attr_timeout=0
+ms() {
+	echo "$(( ($(date +%s%N) - START) / 1000000 )) ms"
+}
+touch ../test/getattr.log 2>&1
+echo "START" > ../test/getattr.log 2>&1
+for MODE in noio_uring io_uring
+do
+	echo "########################################" >> ../test/getattr.log 2>&1
+	echo "mounting filesystem with $MODE" >> ../test/getattr.log 2>&1
+	./kwest_ll mnt -o $MODE,$TIMEOUTS >> ../test/getattr.log 2>&1
+	echo "mount complete" >> ../test/getattr.log 2>&1
+	START=$(date +%s%N)
+	for i in $(seq 1 $ROUNDS)
+	do
+		ls -l mnt/$TAG > /dev/null 2>&1
+	done
+	echo "#01 ls -l of tag x$ROUNDS $(ms)" >> ../test/getattr.log 2>&1
+	START=$(date +%s%N)
+	for i in $(seq 1 $ROUNDS)
+	do
+		stat mnt/$TAG/.git mnt/$TAG/.hidden mnt/$TAG/desktop.ini \
+		     mnt/$TAG/.file.swp > /dev/null 2>&1
+	done
+	echo "#02 stat of missing names x$ROUNDS $(ms)" >> ../test/getattr.log 2>&1
+	START=$(date +%s%N)
+	for i in $(seq 1 $ROUNDS)
+	do
+		find mnt/$TAG > /dev/null 2>&1
+	done
+	echo "#03 find under tag x$ROUNDS $(ms)" >> ../test/getattr.log 2>&1
+	grep -E "^(lookup|getattr) " mnt/.kwest/stats >> ../test/getattr.log 2>&1
+	fusermount3 -u mnt >> ../test/getattr.log 2>&1
+done
+grep -E "mounting|^#|^lookup|^getattr" ../test/getattr.log
+echo "END" >> ../test/getattr.log 2>&1
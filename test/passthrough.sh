@@ -0,0 +1,23 @@
+# compare read throughput of a tagged file through kwest_ll with and
+# without fuse passthrough, run from src after make kwest_ll
+# passthrough needs root, otherwise both runs read through kwest
+# usage: sh ../test/passthrough.sh <path of tagged file under mnt>
+FILE=$1
+touch ../test/passthrough.log 2>&1 
+echo "START" > ../test/passthrough.log 2>&1
+for MODE in nopassthrough passthrough
+do
+	echo "########################################" >> ../test/passthrough.log 2>&1 
+	echo "mounting filesystem with $MODE" >> ../test/passthrough.log 2>&1 
+	./kwest_ll mnt -o $MODE >> ../test/passthrough.log 2>&1 
+	echo "mount complete" >> ../test/passthrough.log 2>&1 
+	echo "#01 cold read" >> ../test/passthrough.log 2>&1 
+	sync
+	echo 3 > /proc/sys/vm/drop_caches 2>/dev/null
+	dd if=mnt/$FILE of=/dev/null bs=1M >> ../test/passthrough.log 2>&1 
+	echo "#02 warm read" >> ../test/passthrough.log 2>&1 
+	dd if=mnt/$FILE of=/dev/null bs=1M >> ../test/passthrough.log 2>&1 
+	fusermount3 -u mnt >> ../test/passthrough.log 2>&1 
+done
+grep -E "mounting|^#|copied" ../test/passthrough.log
+echo "END" >> ../test/passthrough.log 2>&1